@@ -6,28 +6,9 @@
 // data types
 #include <string>
 
-// type constraints
-#include <ranges>
-
-// data structures and algorithms
-#include <array>
-#include <iterator>
-
 // i/o
 #include <iostream>
 
-namespace ranges = std::ranges;
-
-template<ranges::input_range range>
-requires std::same_as<ranges::range_value_t<range>, std::string>
-void log_bad_flags(std::string const & flag_type, range && invalid_names)
-{
-    for (std::string const & name : invalid_names) {
-        std::cerr << "No " << flag_type << " flag named "
-                  << name << ", skipping\n";
-    }
-}
-
 void cleanup(SDL_Window * window, SDL_Renderer * renderer)
 {
     if (renderer) {
@@ -53,26 +34,26 @@ int main()
     SDL_Window * window = nullptr;
     SDL_Renderer * renderer = nullptr;
 
-    std::vector<std::string> invalid_subsystem_flagnames;
-    std::vector<std::string> invalid_window_flagnames;
-    std::vector<std::string> invalid_renderer_flagnames;
+    raisin::log_sink log{ std::cerr };
+    auto const bad_subsystem =
+        log.format("No subsystem flag named {}, skipping");
+    auto const bad_window = log.format("No window flag named {}, skipping");
+    auto const bad_renderer =
+        log.format("No renderer flag named {}, skipping");
 
     SDL_Color draw_color;
     auto result = raisin::parse_file(config_path)
         .and_then(raisin::sdl::init_sdl("system",
-            std::back_inserter(invalid_subsystem_flagnames)))
+            log.names(bad_subsystem)))
         .and_then(raisin::sdl::load_window("window", window,
-            std::back_inserter(invalid_window_flagnames)))
+            log.names(bad_window)))
         .and_then(raisin::sdl::load_renderer("renderer", window, renderer,
-            std::back_inserter(invalid_renderer_flagnames)))
+            log.names(bad_renderer)))
         .and_then(raisin::load(
             "draw.color", draw_color));
 
-    log_bad_flags("subsystem", invalid_subsystem_flagnames);
-    log_bad_flags("window", invalid_window_flagnames);
-    log_bad_flags("renderer", invalid_renderer_flagnames);
-
     if (not result) {
+        log.flush();
         std::cerr << "Couldn't load resources: " << result.error() << "\n";
         cleanup(window, renderer);
         return EXIT_FAILURE;
@@ -0,0 +1,720 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+#include "raisin/hash.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+
+// data structures
+#include <vector>
+#include <span>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <unordered_map>
+
+// algorithms
+#include <algorithm>
+
+// type constraints
+#include <concepts>
+#include <type_traits>
+#include <typeinfo>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin {
+
+using namespace std::string_literals;
+
+/**
+ * \brief A pool that stores each distinct string once
+ *
+ * Strings are copied into large blocks, so interning a string doesn't
+ * allocate unless the current block is full, and the views handed out stay
+ * valid for the life of the pool.
+ */
+class string_pool {
+public:
+    using id = std::uint32_t;
+
+    static std::size_t constexpr block_size = 64 * 1024;
+
+    /**
+     * \brief Get the id of a string, adding it to the pool if it's new
+     */
+    id intern(std::string_view string)
+    {
+        if (auto found = ids.find(string); found != ids.end()) {
+            return found->second;
+        }
+        std::string_view const stored = store(string);
+        id const string_id = static_cast<id>(strings.size());
+        strings.push_back(stored);
+        ids.emplace(stored, string_id);
+        return string_id;
+    }
+
+    std::string_view operator[](id string_id) const
+    {
+        return strings[string_id];
+    }
+
+    std::size_t size() const { return strings.size(); }
+
+    /**
+     * \brief The number of bytes the pool occupies
+     */
+    std::size_t bytes() const
+    {
+        // the index is estimated as one pointer of bucket overhead plus
+        // one heap node per string
+        std::size_t constexpr index_node =
+            sizeof(std::pair<std::string_view, id>) + 2 * sizeof(void *);
+        return allocated +
+               strings.capacity() * sizeof(std::string_view) +
+               ids.bucket_count() * sizeof(void *) + ids.size() * index_node;
+    }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::size_t block_used = block_size;
+    std::size_t allocated = 0;
+    std::vector<std::string_view> strings;
+    std::unordered_map<std::string_view, id> ids;
+
+    std::string_view store(std::string_view string)
+    {
+        if (string.size() > block_size / 4) {
+            // big strings get a block of their own, in front of the current
+            // block so that the current block keeps being filled
+            auto block = std::make_unique<char[]>(string.size());
+            allocated += string.size();
+            std::memcpy(block.get(), string.data(), string.size());
+            std::string_view const stored{ block.get(), string.size() };
+            blocks.insert(blocks.end() - (blocks.empty() ? 0 : 1),
+                          std::move(block));
+            return stored;
+        }
+        if (block_used + string.size() > block_size) {
+            blocks.push_back(std::make_unique<char[]>(block_size));
+            allocated += block_size;
+            block_used = 0;
+        }
+        char * data = blocks.back().get() + block_used;
+        std::memcpy(data, string.data(), string.size());
+        block_used += string.size();
+        return std::string_view{ data, string.size() };
+    }
+};
+
+/**
+ * \brief A value in a compact document
+ *
+ * Scalars are stored inline. Strings refer to the document's string pool,
+ * and tables, arrays and dates refer to the document's storage by index.
+ */
+struct compact_node {
+    toml::node_type type = toml::node_type::none;
+    union {
+        std::int64_t integer;
+        double floating_point;
+        bool boolean;
+        std::uint32_t index = 0;
+    };
+};
+
+struct compact_entry {
+    string_pool::id key;
+    compact_node value;
+};
+
+struct compact_range {
+    std::uint32_t first;
+    std::uint32_t size;
+};
+
+/**
+ * \brief How much memory compacting a document saved
+ *
+ * \note The size of the source document is an estimate of the heap memory a
+ *       toml::table of the same content uses, since toml++ doesn't report it.
+ */
+struct compact_stats {
+    std::size_t source_bytes = 0;
+    std::size_t compact_bytes = 0;
+    std::size_t shared_subtrees = 0;
+
+    std::ptrdiff_t saved_bytes() const
+    {
+        return static_cast<std::ptrdiff_t>(source_bytes) -
+               static_cast<std::ptrdiff_t>(compact_bytes);
+    }
+};
+
+class compact_document;
+
+/**
+ * \brief A read-only view of a node in a compact document
+ */
+class compact_view {
+public:
+    compact_view() = default;
+    compact_view(compact_document const & document, compact_node node)
+        : document{ &document }, node{ node }
+    {
+    }
+
+    explicit operator bool() const
+    {
+        return node.type != toml::node_type::none;
+    }
+
+    toml::node_type type() const { return node.type; }
+    bool is_table() const { return node.type == toml::node_type::table; }
+    bool is_array() const { return node.type == toml::node_type::array; }
+
+    /**
+     * \brief The number of entries in a table or values in an array
+     */
+    std::size_t size() const;
+
+    /**
+     * \brief Look up a key of a table, or nothing if it isn't a table
+     */
+    compact_view operator[](std::string_view key) const;
+
+    /**
+     * \brief Look up an index of an array, or nothing if it isn't an array
+     */
+    compact_view operator[](std::size_t index) const;
+
+    /**
+     * \brief The key of the entry at an index of a table
+     */
+    std::string_view key_at(std::size_t index) const;
+
+    /**
+     * \brief The value of the entry at an index of a table
+     */
+    compact_view value_at(std::size_t index) const;
+
+    /**
+     * \brief Get a node by a toml path, such as "prefabs.entries[3].name"
+     */
+    compact_view at_path(std::string_view variable_path) const;
+
+    /**
+     * \brief Get the value of a native type, following toml++'s conversions
+     */
+    template<native value_t>
+    std::optional<value_t> value() const;
+
+    /**
+     * \brief Copy the node back into a toml node
+     */
+    std::unique_ptr<toml::node> expand() const;
+
+private:
+    compact_document const * document = nullptr;
+    compact_node node;
+};
+
+/**
+ * \brief A read-only toml document that stores repeated content once
+ *
+ * Every key and string value is stored once in a string pool, and tables and
+ * arrays whose values are all scalars are stored once no matter how many
+ * times they occur. Large documents with many repeated keys, such as
+ * prefab libraries of [[entries]], take a fraction of the memory of the
+ * equivalent toml::table.
+ *
+ *      auto document = raisin::compact_document{ *table_result };
+ *      std::cout << "saved " << document.stats().saved_bytes() << " bytes\n";
+ *
+ *      auto health = raisin::load_value<int>(document, "goblin.health");
+ */
+class compact_document {
+public:
+    /**
+     * \brief Compact a toml table
+     */
+    explicit compact_document(toml::table const & table)
+    {
+        stats_.source_bytes = _estimate_bytes(table);
+        root_node = add(table);
+        entries.shrink_to_fit();
+        elements.shrink_to_fit();
+        tables.shrink_to_fit();
+        arrays.shrink_to_fit();
+        date_times.shrink_to_fit();
+        shared.clear();
+        shared.rehash(0);
+
+        stats_.compact_bytes = sizeof(*this) + pool.bytes() +
+            entries.capacity() * sizeof(compact_entry) +
+            elements.capacity() * sizeof(compact_node) +
+            tables.capacity() * sizeof(compact_range) +
+            arrays.capacity() * sizeof(compact_range) +
+            date_times.capacity() * sizeof(toml::date_time);
+    }
+
+    compact_view root() const { return compact_view{ *this, root_node }; }
+
+    compact_view at_path(std::string_view variable_path) const
+    {
+        return root().at_path(variable_path);
+    }
+
+    compact_stats const & stats() const { return stats_; }
+
+    /**
+     * \brief Copy a subtable back into a toml::table for other loaders
+     *
+     * \param variable_path     the toml path to the subtable, or the empty
+     *                          string for the whole document
+     */
+    expected<toml::table, std::string>
+    expand(std::string const & variable_path) const
+    {
+        compact_view const view = variable_path.empty() ?
+            root() : at_path(variable_path);
+        if (not view) {
+            return unexpected{ _missing_variable(variable_path) };
+        }
+        if (not view.is_table()) {
+            std::string const description =
+                "Expecting "s + variable_path + " to be a table, "s +
+                "but it wasn't"s;
+            return unexpected{ description };
+        }
+        return std::move(*view.expand()->as_table());
+    }
+
+private:
+    friend class compact_view;
+
+    string_pool pool;
+    std::vector<compact_entry> entries;
+    std::vector<compact_node> elements;
+    std::vector<compact_range> tables;
+    std::vector<compact_range> arrays;
+    std::vector<toml::date_time> date_times;
+    compact_node root_node;
+    compact_stats stats_;
+
+    // scalar-only tables and arrays by the hash of their content
+    std::unordered_multimap<std::uint64_t, compact_node> shared;
+
+    static bool is_scalar(compact_node const & node)
+    {
+        return node.type != toml::node_type::table and
+               node.type != toml::node_type::array;
+    }
+
+    static std::uint64_t hash_scalar(compact_node const & node)
+    {
+        std::uint64_t bits = 0;
+        switch (node.type) {
+        case toml::node_type::integer:
+            bits = static_cast<std::uint64_t>(node.integer);
+            break;
+        case toml::node_type::floating_point:
+            std::memcpy(&bits, &node.floating_point, sizeof(bits));
+            break;
+        case toml::node_type::boolean:
+            bits = node.boolean;
+            break;
+        default:
+            bits = node.index;
+            break;
+        }
+        return hash_combine(static_cast<std::uint64_t>(node.type), bits);
+    }
+
+    static bool same_scalar(compact_node const & lhs, compact_node const & rhs)
+    {
+        if (lhs.type != rhs.type) { return false; }
+        switch (lhs.type) {
+        case toml::node_type::integer:
+            return lhs.integer == rhs.integer;
+        case toml::node_type::floating_point:
+            return std::memcmp(&lhs.floating_point, &rhs.floating_point,
+                               sizeof(double)) == 0;
+        case toml::node_type::boolean:
+            return lhs.boolean == rhs.boolean;
+        default:
+            return lhs.index == rhs.index;
+        }
+    }
+
+    compact_node add(toml::node const & node)
+    {
+        compact_node compact;
+        compact.type = node.type();
+        switch (compact.type) {
+        case toml::node_type::table:
+            return add_table(*node.as_table());
+        case toml::node_type::array:
+            return add_array(*node.as_array());
+        case toml::node_type::string:
+            compact.index = pool.intern(node.as_string()->get());
+            break;
+        case toml::node_type::integer:
+            compact.integer = node.as_integer()->get();
+            break;
+        case toml::node_type::floating_point:
+            compact.floating_point = node.as_floating_point()->get();
+            break;
+        case toml::node_type::boolean:
+            compact.boolean = node.as_boolean()->get();
+            break;
+        case toml::node_type::date:
+            compact.index = static_cast<std::uint32_t>(date_times.size());
+            date_times.push_back({ node.as_date()->get(), {} });
+            break;
+        case toml::node_type::time:
+            compact.index = static_cast<std::uint32_t>(date_times.size());
+            date_times.push_back({ {}, node.as_time()->get() });
+            break;
+        case toml::node_type::date_time:
+            compact.index = static_cast<std::uint32_t>(date_times.size());
+            date_times.push_back(node.as_date_time()->get());
+            break;
+        default:
+            break;
+        }
+        return compact;
+    }
+
+    compact_node add_table(toml::table const & table)
+    {
+        std::vector<compact_entry> children;
+        children.reserve(table.size());
+        for (auto && [key, value] : table) {
+            children.push_back({ pool.intern(key.str()), add(value) });
+        }
+
+        bool const leaf = std::ranges::all_of(children,
+            [](compact_entry const & entry) { return is_scalar(entry.value); });
+
+        std::uint64_t hash = 0;
+        if (leaf) {
+            hash = hash_combine(1, children.size());
+            for (compact_entry const & entry : children) {
+                hash = hash_combine(hash, entry.key);
+                hash = hash_combine(hash, hash_scalar(entry.value));
+            }
+            if (auto node = find_shared(hash, children)) { return *node; }
+        }
+
+        compact_node compact;
+        compact.type = toml::node_type::table;
+        compact.index = static_cast<std::uint32_t>(tables.size());
+        tables.push_back({ static_cast<std::uint32_t>(entries.size()),
+                           static_cast<std::uint32_t>(children.size()) });
+        entries.insert(entries.end(), children.begin(), children.end());
+        if (leaf) { shared.emplace(hash, compact); }
+        return compact;
+    }
+
+    compact_node add_array(toml::array const & array)
+    {
+        std::vector<compact_node> children;
+        children.reserve(array.size());
+        for (toml::node const & value : array) {
+            children.push_back(add(value));
+        }
+
+        bool const leaf = std::ranges::all_of(children, is_scalar);
+
+        std::uint64_t hash = 0;
+        if (leaf) {
+            hash = hash_combine(2, children.size());
+            for (compact_node const & child : children) {
+                hash = hash_combine(hash, hash_scalar(child));
+            }
+            if (auto node = find_shared(hash, children)) { return *node; }
+        }
+
+        compact_node compact;
+        compact.type = toml::node_type::array;
+        compact.index = static_cast<std::uint32_t>(arrays.size());
+        arrays.push_back({ static_cast<std::uint32_t>(elements.size()),
+                           static_cast<std::uint32_t>(children.size()) });
+        elements.insert(elements.end(), children.begin(), children.end());
+        if (leaf) { shared.emplace(hash, compact); }
+        return compact;
+    }
+
+    std::optional<compact_node>
+    find_shared(std::uint64_t hash, std::vector<compact_entry> const & children)
+    {
+        auto [first, last] = shared.equal_range(hash);
+        for (; first != last; ++first) {
+            compact_node const & candidate = first->second;
+            if (candidate.type != toml::node_type::table) { continue; }
+
+            compact_range const range = tables[candidate.index];
+            bool const same = std::ranges::equal(
+                children, std::span{ entries }.subspan(range.first, range.size),
+                [](compact_entry const & lhs, compact_entry const & rhs) {
+                    return lhs.key == rhs.key and
+                           same_scalar(lhs.value, rhs.value);
+                });
+            if (same) {
+                ++stats_.shared_subtrees;
+                return candidate;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<compact_node>
+    find_shared(std::uint64_t hash, std::vector<compact_node> const & children)
+    {
+        auto [first, last] = shared.equal_range(hash);
+        for (; first != last; ++first) {
+            compact_node const & candidate = first->second;
+            if (candidate.type != toml::node_type::array) { continue; }
+
+            compact_range const range = arrays[candidate.index];
+            bool const same = std::ranges::equal(
+                children, std::span{ elements }.subspan(range.first, range.size),
+                same_scalar);
+            if (same) {
+                ++stats_.shared_subtrees;
+                return candidate;
+            }
+        }
+        return std::nullopt;
+    }
+
+    static std::size_t _estimate_bytes(toml::node const & node)
+    {
+        // heap strings beyond the small string buffer
+        auto const string_bytes = [](std::string_view string) {
+            return string.size() < sizeof(std::string) ?
+                std::size_t{ 0 } : string.size() + 1;
+        };
+
+        if (auto const * table = node.as_table()) {
+            // each entry is a tree node holding a key and a node pointer
+            std::size_t constexpr entry = 4 * sizeof(void *) +
+                sizeof(toml::key) + sizeof(void *);
+            std::size_t bytes = sizeof(toml::table);
+            for (auto && [key, value] : *table) {
+                bytes += entry + string_bytes(key.str()) +
+                         _estimate_bytes(value);
+            }
+            return bytes;
+        }
+        if (auto const * array = node.as_array()) {
+            std::size_t bytes = sizeof(toml::array);
+            for (toml::node const & value : *array) {
+                bytes += sizeof(void *) + _estimate_bytes(value);
+            }
+            return bytes;
+        }
+        if (auto const * string = node.as_string()) {
+            return sizeof(*string) + string_bytes(string->get());
+        }
+        if (node.is_integer()) { return sizeof(toml::value<std::int64_t>); }
+        if (node.is_floating_point()) { return sizeof(toml::value<double>); }
+        if (node.is_boolean()) { return sizeof(toml::value<bool>); }
+        return sizeof(toml::value<toml::date_time>);
+    }
+};
+
+inline std::size_t compact_view::size() const
+{
+    if (is_table()) { return document->tables[node.index].size; }
+    if (is_array()) { return document->arrays[node.index].size; }
+    return 0;
+}
+
+inline compact_view compact_view::operator[](std::string_view key) const
+{
+    if (not is_table()) { return {}; }
+
+    // entries are in toml++'s key order, so they can be searched
+    compact_range const range = document->tables[node.index];
+    auto const * first = document->entries.data() + range.first;
+    auto const * last = first + range.size;
+    auto const * found = std::lower_bound(first, last, key,
+        [this](compact_entry const & entry, std::string_view key) {
+            return document->pool[entry.key] < key;
+        });
+    if (found == last or document->pool[found->key] != key) { return {}; }
+    return compact_view{ *document, found->value };
+}
+
+inline compact_view compact_view::operator[](std::size_t index) const
+{
+    if (not is_array()) { return {}; }
+    compact_range const range = document->arrays[node.index];
+    if (index >= range.size) { return {}; }
+    return compact_view{ *document, document->elements[range.first + index] };
+}
+
+inline std::string_view compact_view::key_at(std::size_t index) const
+{
+    compact_range const range = document->tables[node.index];
+    return document->pool[document->entries[range.first + index].key];
+}
+
+inline compact_view compact_view::value_at(std::size_t index) const
+{
+    compact_range const range = document->tables[node.index];
+    return compact_view{ *document,
+                         document->entries[range.first + index].value };
+}
+
+inline compact_view compact_view::at_path(std::string_view path) const
+{
+    compact_view view = *this;
+    while (view and not path.empty()) {
+        if (path.front() == '.') {
+            path.remove_prefix(1);
+        }
+        else if (path.front() == '[') {
+            auto const close = path.find(']');
+            if (close == std::string_view::npos) { return {}; }
+            std::size_t index = 0;
+            auto const digits = path.substr(1, close - 1);
+            auto const [end, error] = std::from_chars(
+                    digits.data(), digits.data() + digits.size(), index);
+            if (error != std::errc{} or end != digits.data() + digits.size()) {
+                return {};
+            }
+            view = view[index];
+            path.remove_prefix(close + 1);
+        }
+        else {
+            auto const key_end = std::min(path.find_first_of(".["),
+                                          path.size());
+            view = view[path.substr(0, key_end)];
+            path.remove_prefix(key_end);
+        }
+    }
+    return view;
+}
+
+template<native value_t>
+std::optional<value_t> compact_view::value() const
+{
+    switch (node.type) {
+    case toml::node_type::boolean:
+        if constexpr (std::same_as<value_t, bool>) { return node.boolean; }
+        break;
+    case toml::node_type::integer:
+        // like toml++, only integers the type holds exactly
+        if constexpr (std::integral<value_t> and
+                      not std::same_as<value_t, bool>) {
+            if (not std::in_range<value_t>(node.integer)) { return {}; }
+            return static_cast<value_t>(node.integer);
+        }
+        else if constexpr (std::floating_point<value_t>) {
+            auto const converted = static_cast<value_t>(node.integer);
+            if (converted >= static_cast<value_t>(0x1p63) or
+                static_cast<std::int64_t>(converted) != node.integer) {
+                return {};
+            }
+            return converted;
+        }
+        break;
+    case toml::node_type::floating_point:
+        if constexpr (std::floating_point<value_t>) {
+            return static_cast<value_t>(node.floating_point);
+        }
+        break;
+    case toml::node_type::string:
+        if constexpr (std::convertible_to<std::string, value_t> and
+                      not std::is_arithmetic_v<value_t>) {
+            return value_t(std::string{ document->pool[node.index] });
+        }
+        break;
+    default:
+        break;
+    }
+    return std::nullopt;
+}
+
+inline std::unique_ptr<toml::node> compact_view::expand() const
+{
+    switch (node.type) {
+    case toml::node_type::table: {
+        auto table = std::make_unique<toml::table>();
+        for (std::size_t i = 0; i < size(); ++i) {
+            value_at(i).expand()->visit([&](auto & value) {
+                table->insert(key_at(i), std::move(value));
+            });
+        }
+        return table;
+    }
+    case toml::node_type::array: {
+        auto array = std::make_unique<toml::array>();
+        array->reserve(size());
+        for (std::size_t i = 0; i < size(); ++i) {
+            (*this)[i].expand()->visit([&](auto & value) {
+                array->push_back(std::move(value));
+            });
+        }
+        return array;
+    }
+    case toml::node_type::string:
+        return std::make_unique<toml::value<std::string>>(
+                std::string{ document->pool[node.index] });
+    case toml::node_type::integer:
+        return std::make_unique<toml::value<std::int64_t>>(node.integer);
+    case toml::node_type::floating_point:
+        return std::make_unique<toml::value<double>>(node.floating_point);
+    case toml::node_type::boolean:
+        return std::make_unique<toml::value<bool>>(node.boolean);
+    case toml::node_type::date:
+        return std::make_unique<toml::value<toml::date>>(
+                document->date_times[node.index].date);
+    case toml::node_type::time:
+        return std::make_unique<toml::value<toml::time>>(
+                document->date_times[node.index].time);
+    default:
+        return std::make_unique<toml::value<toml::date_time>>(
+                document->date_times[node.index]);
+    }
+}
+
+/**
+ * \brief Load a native value from a compact document
+ *
+ * \param document          the document to load data from
+ * \param variable_path     the toml path to the variable to load
+ *
+ * \return the loaded value, or a descriptive error message on failure
+ */
+template<native value_t>
+expected<value_t, std::string>
+load_value(compact_document const & document,
+           std::string const & variable_path)
+{
+    compact_view const view = document.at_path(variable_path);
+    if (not view) {
+        return unexpected{ _missing_variable(variable_path) };
+    }
+    auto value_result = view.value<value_t>();
+    if (not value_result) {
+        std::string const description =
+            "Expecting "s + variable_path + " to have type "s +
+            typeid(value_t).name() + ", but it doesn't"s;
+        return unexpected{ description };
+    }
+    return *value_result;
+}
+}
@@ -0,0 +1,372 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <charconv>
+#include <cassert>
+
+// data structures
+#include <map>
+#include <array>
+#include <vector>
+#include <optional>
+#include <functional>
+
+// algorithms
+#include <algorithm>
+
+// type constraints
+#include <concepts>
+#include <type_traits>
+
+// concurrency
+#include <atomic>
+#include <mutex>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin {
+
+using namespace std::string_literals;
+
+namespace limits {
+// the size of a cache line, which each console variable's value gets to itself
+std::size_t constexpr cache_line_size = 64;
+}
+
+/**
+ * \brief A type a console variable can have
+ *
+ * Console variables are read without locks, so only types whose atomics are
+ * lock-free can be console variables.
+ */
+template<typename value_t>
+concept cvar_value = (std::integral<value_t> or
+                      std::floating_point<value_t>) and
+                     std::atomic<value_t>::is_always_lock_free;
+
+class cvar_registry;
+
+/**
+ * \brief The part of a console variable that doesn't depend on its type
+ */
+class _cvar_base {
+public:
+    explicit _cvar_base(std::string path)
+        : variable_path{ std::move(path) }
+    {
+    }
+
+    _cvar_base(_cvar_base const &) = delete;
+    _cvar_base & operator=(_cvar_base const &) = delete;
+    virtual ~_cvar_base() = default;
+
+    std::string const & path() const { return variable_path; }
+
+    // set the value from a node, or the default if the node is null
+    virtual std::optional<std::string> assign(toml::node const * node) = 0;
+    virtual std::string text() const = 0;
+    virtual void notify() = 0;
+
+private:
+    friend class cvar_registry;
+
+    std::string variable_path;
+
+    // whether the variable is waiting for its callbacks to run
+    std::atomic<bool> queued = false;
+};
+
+/**
+ * \brief The set of console variables that are loaded and set together
+ *
+ * Changing a variable from any thread queues its change callbacks, which run
+ * the next time the main thread calls dispatch_changes:
+ *
+ *      auto config = raisin::parse_file("config.toml")
+ *          .and_then([](auto const & table) {
+ *              return raisin::cvar_registry::global().load(table);
+ *          });
+ *
+ *      // in the main loop
+ *      raisin::cvar_registry::global().dispatch_changes();
+ *
+ * \note Registration, loading and setting take a lock, but reading a console
+ *       variable never does.
+ */
+class cvar_registry {
+public:
+    cvar_registry() = default;
+    cvar_registry(cvar_registry const &) = delete;
+    cvar_registry & operator=(cvar_registry const &) = delete;
+
+    /**
+     * \brief The registry that console variables join by default
+     */
+    static cvar_registry & global()
+    {
+        static cvar_registry registry;
+        return registry;
+    }
+
+    /**
+     * \brief Load every registered variable from a table
+     *
+     * \param table     the table to load from
+     *
+     * \return the table, or a descriptive message of every variable that
+     *         failed to load
+     *
+     * \note Variables that aren't in the table are reset to their defaults,
+     *       so removing a variable from a config and reloading it undoes the
+     *       change. Variables that fail to load keep their value.
+     */
+    expected<toml::table, std::string> load(toml::table const & table)
+    {
+        std::string errors;
+        std::scoped_lock const lock{ mutex };
+        for (auto const & [path, variable] : variables) {
+            auto error = variable->assign(table.at_path(path).node());
+            if (not error) { continue; }
+            if (not errors.empty()) { errors += '\n'; }
+            errors += *error;
+        }
+        if (not errors.empty()) { return unexpected{ errors }; }
+        return table;
+    }
+
+    /**
+     * \brief Set a variable from console text
+     *
+     * \param variable_path     the path of the variable to set
+     * \param text              the new value, written as a toml value
+     *
+     * \return nothing, or a descriptive error message if there's no such
+     *         variable or the text isn't a value of its type
+     */
+    expected<void, std::string>
+    set(std::string_view variable_path, std::string_view text)
+    {
+        std::scoped_lock const lock{ mutex };
+        auto const found = variables.find(variable_path);
+        if (found == variables.end()) {
+            return unexpected{ "There's no console variable "s +
+                               std::string{ variable_path } };
+        }
+
+        std::string const document = "value = "s + std::string{ text };
+        toml::parse_result const result = toml::parse(document);
+        if (not result) {
+            return unexpected{ "Couldn't read "s + std::string{ text } +
+                               " as a value for "s + found->first };
+        }
+        auto const error = found->second->assign(
+                result.table().get("value"));
+        if (error) { return unexpected{ *error }; }
+        return {};
+    }
+
+    /**
+     * \brief Get the value of a variable as console text
+     *
+     * \return the value, or a descriptive error message if there's no such
+     *         variable
+     */
+    expected<std::string, std::string> text(std::string_view variable_path)
+    {
+        std::scoped_lock const lock{ mutex };
+        auto const found = variables.find(variable_path);
+        if (found == variables.end()) {
+            return unexpected{ "There's no console variable "s +
+                               std::string{ variable_path } };
+        }
+        return found->second->text();
+    }
+
+    /**
+     * \brief The paths of every registered variable, in order
+     */
+    std::vector<std::string> paths() const
+    {
+        std::scoped_lock const lock{ mutex };
+        std::vector<std::string> result;
+        for (auto const & [path, variable] : variables) {
+            result.push_back(path);
+        }
+        return result;
+    }
+
+    /**
+     * \brief Run the change callbacks of every variable that changed since
+     *        the last dispatch
+     *
+     * \note Call this from the main thread. Each callback runs once with the
+     *       variable's latest value, however many times it changed.
+     */
+    void dispatch_changes()
+    {
+        std::vector<_cvar_base *> changed;
+        {
+            std::scoped_lock const lock{ pending_mutex };
+            changed.swap(pending);
+        }
+        for (_cvar_base * variable : changed) {
+            variable->queued.store(false);
+            variable->notify();
+        }
+    }
+
+private:
+    template<cvar_value>
+    friend class cvar;
+
+    // loading and setting change variables with the mutex held, so the
+    // queue of changed variables has a mutex of its own
+    mutable std::mutex mutex;
+    std::map<std::string, _cvar_base *, std::less<>> variables;
+    std::mutex pending_mutex;
+    std::vector<_cvar_base *> pending;
+
+    void add(_cvar_base & variable)
+    {
+        std::scoped_lock const lock{ mutex };
+        bool const added = variables.emplace(variable.path(), &variable).second;
+        assert(added and "a variable with the same path is already registered");
+        (void)added;
+    }
+
+    void remove(_cvar_base & variable)
+    {
+        std::scoped_lock const lock{ mutex };
+        auto const found = variables.find(variable.path());
+        if (found != variables.end() and found->second == &variable) {
+            variables.erase(found);
+        }
+        std::scoped_lock const pending_lock{ pending_mutex };
+        std::erase(pending, &variable);
+    }
+
+    void queue(_cvar_base & variable)
+    {
+        if (variable.queued.exchange(true)) { return; }
+        std::scoped_lock const lock{ pending_mutex };
+        pending.push_back(&variable);
+    }
+};
+
+/**
+ * \brief A setting that any thread can read every frame and that a console
+ *        or a reload can change
+ *
+ * Declare console variables statically with their path and default value:
+ *
+ *      inline raisin::cvar<float> render_scale{ "render.scale", 1.0f };
+ *
+ *      float const scale = render_scale.get();
+ *
+ * Reading a variable is a relaxed atomic load of a value with a cache line to
+ * itself, so threads reading different variables don't contend.
+ *
+ * \note Reads are relaxed, so a change is seen by other threads soon, but not
+ *       in any order relative to other memory.
+ */
+template<cvar_value value_t>
+class alignas(limits::cache_line_size) cvar final : public _cvar_base {
+public:
+    /**
+     * \brief Declare a console variable
+     *
+     * \param variable_path     the toml path the variable loads from, which
+     *                          is also its name on the console
+     * \param default_val       the value before it's loaded or set
+     * \param registry          the registry the variable joins
+     *
+     * \note No other variable in the registry may have the same path.
+     */
+    cvar(std::string variable_path, value_t default_val,
+         cvar_registry & registry = cvar_registry::global())
+        : _cvar_base{ std::move(variable_path) },
+          default_val{ default_val },
+          registry{ registry },
+          current{ default_val }
+    {
+        registry.add(*this);
+    }
+
+    ~cvar() override { registry.remove(*this); }
+
+    /**
+     * \brief Read the value
+     */
+    value_t get() const { return current.load(std::memory_order_relaxed); }
+
+    operator value_t() const { return get(); }
+
+    /**
+     * \brief Change the value, queuing change callbacks if it's different
+     */
+    void set(value_t value)
+    {
+        if (current.exchange(value, std::memory_order_relaxed) != value) {
+            registry.queue(*this);
+        }
+    }
+
+    /**
+     * \brief Run a function on the main thread whenever the value changes
+     *
+     * \note Call this from the main thread, which runs the callbacks.
+     */
+    void on_change(std::function<void(value_t)> callback)
+    {
+        callbacks.push_back(std::move(callback));
+    }
+
+    std::optional<std::string> assign(toml::node const * node) override
+    {
+        if (not node) {
+            set(default_val);
+            return std::nullopt;
+        }
+        auto result = load_node_value<value_t>(node, path());
+        if (not result) { return result.error(); }
+        set(*result);
+        return std::nullopt;
+    }
+
+    std::string text() const override
+    {
+        if constexpr (std::same_as<value_t, bool>) {
+            return get() ? "true"s : "false"s;
+        }
+        else {
+            // the shortest text that reads back as the same value
+            std::array<char, 32> buffer;
+            auto const end = std::to_chars(buffer.data(),
+                                           buffer.data() + buffer.size(),
+                                           get()).ptr;
+            return std::string{ buffer.data(), end };
+        }
+    }
+
+    void notify() override
+    {
+        value_t const value = get();
+        for (auto const & callback : callbacks) { callback(value); }
+    }
+
+private:
+    value_t const default_val;
+    cvar_registry & registry;
+    std::vector<std::function<void(value_t)>> callbacks;
+
+    // last, so that it starts a cache line that nothing else shares
+    alignas(limits::cache_line_size) std::atomic<value_t> current;
+};
+}
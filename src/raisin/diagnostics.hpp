@@ -0,0 +1,149 @@
+#pragma once
+#include "raisin/future.hpp"
+
+// data types
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// data structures
+#include <array>
+#include <span>
+
+// algorithms
+#include <algorithm>
+
+// type constraints
+#include <iterator>
+
+namespace raisin {
+
+namespace limits {
+std::size_t constexpr diagnostic_name_size = 31;
+}
+
+/**
+ * \brief An invalid name found while loading, and where it was found
+ *
+ * \note The name is copied inline and truncated to
+ *       limits::diagnostic_name_size characters. The path is only viewed, so
+ *       it must outlive the diagnostic; string literals are the usual case.
+ */
+struct diagnostic {
+    std::string_view path;
+    std::array<char, limits::diagnostic_name_size> name_data;
+    std::uint8_t name_size = 0;
+    bool truncated = false;
+
+    std::string_view name() const
+    {
+        return std::string_view{ name_data.data(), name_size };
+    }
+};
+
+/**
+ * \brief A fixed-capacity collection of invalid names
+ *
+ * Names are written through the output iterator returned by names(), so a
+ * collector can be passed to any loader taking a name_output. Nothing is
+ * allocated: once capacity diagnostics are stored, any more are counted as
+ * overflow rather than stored.
+ *
+ *      raisin::diagnostics<16> invalid;
+ *      auto result = raisin::parse_file(config_path)
+ *          .and_then(raisin::sdl::load_window("window", window,
+ *              invalid.names("window.flags")));
+ *
+ *      for (raisin::diagnostic const & bad : invalid) {
+ *          std::cerr << bad.path << ": no flag named " << bad.name() << "\n";
+ *      }
+ */
+template<std::size_t capacity>
+class diagnostics {
+public:
+    /**
+     * \brief An output iterator that records every name written to it
+     */
+    class name_output {
+    public:
+        using difference_type = std::ptrdiff_t;
+
+        name_output() = default;
+        name_output(diagnostics & collector, std::string_view path)
+            : collector{ &collector }, path{ path }
+        {
+        }
+
+        name_output & operator*() { return *this; }
+        name_output & operator++() { return *this; }
+        name_output operator++(int) { return *this; }
+
+        name_output & operator=(std::string_view name)
+        {
+            if (collector) { collector->push(path, name); }
+            return *this;
+        }
+
+    private:
+        diagnostics * collector = nullptr;
+        std::string_view path;
+    };
+
+    /**
+     * \brief Get an output iterator that records names found at a path
+     *
+     * \param path  the toml path to report the names with
+     */
+    name_output names(std::string_view path)
+    {
+        return name_output{ *this, path };
+    }
+
+    /**
+     * \brief Record an invalid name
+     *
+     * \return false if the collector is full and the name was only counted
+     */
+    bool push(std::string_view path, std::string_view name)
+    {
+        if (count == capacity) {
+            ++overflowed;
+            return false;
+        }
+        diagnostic & entry = entries[count++];
+        entry.path = path;
+        entry.name_size = static_cast<std::uint8_t>(
+                std::min(name.size(), entry.name_data.size()));
+        entry.truncated = entry.name_size < name.size();
+        std::memcpy(entry.name_data.data(), name.data(), entry.name_size);
+        return true;
+    }
+
+    void clear()
+    {
+        count = 0;
+        overflowed = 0;
+    }
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0 and overflowed == 0; }
+
+    /**
+     * \brief The number of names that didn't fit in the collector
+     */
+    std::size_t overflow() const { return overflowed; }
+
+    std::span<diagnostic const> view() const
+    {
+        return std::span{ entries.data(), count };
+    }
+    diagnostic const * begin() const { return entries.data(); }
+    diagnostic const * end() const { return entries.data() + count; }
+
+private:
+    std::array<diagnostic, capacity> entries;
+    std::size_t count = 0;
+    std::size_t overflowed = 0;
+};
+}
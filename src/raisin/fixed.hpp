@@ -0,0 +1,428 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+// data structures
+#include <span>
+#include <optional>
+
+// algorithms
+#include <algorithm>
+
+// type constraints
+#include <concepts>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+inline namespace raisin {
+
+using namespace std::string_literals;
+
+template<std::size_t total_bits>
+struct _fixed_storage;
+
+template<>
+struct _fixed_storage<32> {
+    using type = std::int32_t;
+    using wide = std::int64_t;
+};
+
+#if defined(__SIZEOF_INT128__)
+template<>
+struct _fixed_storage<64> {
+    using type = std::int64_t;
+    using wide = __int128;
+};
+#endif
+
+/**
+ * \brief Add, subtract or negate signed integers in their unsigned type, so
+ *        overflow wraps the same way everywhere instead of being undefined
+ */
+template<std::signed_integral storage_t>
+constexpr storage_t _wrapping_add(storage_t a, storage_t b)
+{
+    using unsigned_t = std::make_unsigned_t<storage_t>;
+    return static_cast<storage_t>(
+        static_cast<unsigned_t>(a) + static_cast<unsigned_t>(b));
+}
+
+template<std::signed_integral storage_t>
+constexpr storage_t _wrapping_subtract(storage_t a, storage_t b)
+{
+    using unsigned_t = std::make_unsigned_t<storage_t>;
+    return static_cast<storage_t>(
+        static_cast<unsigned_t>(a) - static_cast<unsigned_t>(b));
+}
+
+/**
+ * \brief A signed fixed-point number for deterministic arithmetic
+ *
+ * The number is stored as an integer scaled by 2^fraction_bits, so every
+ * operation gives the same bits on every machine. Products and quotients are
+ * computed in an integer twice as wide, then rounded or truncated back:
+ *
+ *      using unit = raisin::fixed<16, 16>;
+ *      auto speed = raisin::load_value<unit>(table, "units.tank.speed");
+ *      position += *speed * unit{ 2 };
+ *
+ * Addition, subtraction and negation wrap around on overflow, identically on
+ * every machine.
+ *
+ * \note 64-bit numbers need a compiler with 128-bit integers.
+ */
+template<std::size_t integer_bits, std::size_t fraction_bits>
+    requires (integer_bits + fraction_bits == 32 or
+              integer_bits + fraction_bits == 64) and
+             (integer_bits > 0 and fraction_bits > 0)
+class fixed {
+public:
+    using storage_type =
+        typename _fixed_storage<integer_bits + fraction_bits>::type;
+    using wide_type =
+        typename _fixed_storage<integer_bits + fraction_bits>::wide;
+
+    static std::size_t constexpr fraction = fraction_bits;
+    static storage_type constexpr one = storage_type{ 1 } << fraction_bits;
+
+    constexpr fixed() = default;
+
+    /**
+     * \brief Make a number from an integer, which wraps around if it's out of
+     *        range
+     */
+    template<std::integral integer_t>
+    constexpr fixed(integer_t integer)
+        : raw{ static_cast<storage_type>(
+                   static_cast<std::make_unsigned_t<storage_type>>(integer)
+                   << fraction_bits) }
+    {
+    }
+
+    /**
+     * \brief Make a number from its scaled integer representation
+     */
+    static constexpr fixed from_raw(storage_type raw)
+    {
+        fixed number;
+        number.raw = raw;
+        return number;
+    }
+
+    static constexpr fixed min() { return from_raw(std::numeric_limits<storage_type>::min()); }
+    static constexpr fixed max() { return from_raw(std::numeric_limits<storage_type>::max()); }
+
+    /**
+     * \brief The scaled integer representation
+     */
+    constexpr storage_type bits() const { return raw; }
+
+    /**
+     * \brief The number as a double, for presentation only
+     */
+    constexpr double to_double() const
+    {
+        return static_cast<double>(raw) / static_cast<double>(one);
+    }
+
+    /**
+     * \brief The integer part, rounded toward negative infinity
+     */
+    constexpr storage_type floor() const { return raw >> fraction_bits; }
+
+    friend constexpr auto operator<=>(fixed, fixed) = default;
+
+    friend constexpr fixed operator+(fixed a, fixed b)
+    {
+        return from_raw(_wrapping_add(a.raw, b.raw));
+    }
+    friend constexpr fixed operator-(fixed a, fixed b)
+    {
+        return from_raw(_wrapping_subtract(a.raw, b.raw));
+    }
+    friend constexpr fixed operator-(fixed a)
+    {
+        return from_raw(_wrapping_subtract(storage_type{ 0 }, a.raw));
+    }
+
+    /**
+     * \brief Multiply, rounding half up to the nearest representable number
+     */
+    friend constexpr fixed operator*(fixed a, fixed b)
+    {
+        wide_type const product = static_cast<wide_type>(a.raw) * b.raw;
+        wide_type const half = wide_type{ 1 } << (fraction_bits - 1);
+        return from_raw(static_cast<storage_type>(
+                (product + half) >> fraction_bits));
+    }
+
+    /**
+     * \brief Divide, truncating toward zero
+     *
+     * \note Dividing by zero is undefined, as with integers.
+     */
+    friend constexpr fixed operator/(fixed a, fixed b)
+    {
+        wide_type const dividend =
+            static_cast<wide_type>(a.raw) * static_cast<wide_type>(one);
+        return from_raw(static_cast<storage_type>(dividend / b.raw));
+    }
+
+    constexpr fixed & operator+=(fixed other) { return *this = *this + other; }
+    constexpr fixed & operator-=(fixed other) { return *this = *this - other; }
+    constexpr fixed & operator*=(fixed other) { return *this = *this * other; }
+    constexpr fixed & operator/=(fixed other) { return *this = *this / other; }
+
+private:
+    storage_type raw = 0;
+};
+
+template<typename value_t>
+inline constexpr bool _is_fixed = false;
+
+template<std::size_t integer_bits, std::size_t fraction_bits>
+inline constexpr bool _is_fixed<fixed<integer_bits, fraction_bits>> = true;
+
+template<typename value_t>
+concept fixed_point = _is_fixed<value_t>;
+
+/**
+ * \brief Round a magnitude and sign into a fixed-point number
+ *
+ * \return the number, or nothing if it's out of range
+ */
+template<fixed_point fixed_t>
+std::optional<fixed_t> _make_fixed(std::uint64_t magnitude, bool negative)
+{
+    using storage_t = typename fixed_t::storage_type;
+    std::uint64_t const max = static_cast<std::uint64_t>(
+            std::numeric_limits<storage_t>::max());
+    if (magnitude > max + (negative ? 1 : 0)) { return std::nullopt; }
+    if (not negative) {
+        return fixed_t::from_raw(static_cast<storage_t>(magnitude));
+    }
+    // negate in unsigned arithmetic so the minimum doesn't overflow
+    return fixed_t::from_raw(static_cast<storage_t>(
+            static_cast<std::make_unsigned_t<storage_t>>(0 - magnitude)));
+}
+
+/**
+ * \brief Parse a decimal number like "-12.375" exactly into fixed point,
+ *        rounding the fraction half up to the nearest representable number
+ *
+ * \return the number, or nothing if the text isn't a decimal number or is
+ *         out of range
+ */
+template<fixed_point fixed_t>
+std::optional<fixed_t> parse_fixed(std::string_view text)
+{
+    std::size_t constexpr fraction_bits = fixed_t::fraction;
+    std::size_t constexpr integer_bits =
+        8 * sizeof(typename fixed_t::storage_type) - fraction_bits;
+
+    bool const negative = not text.empty() and text.front() == '-';
+    if (not text.empty() and (text.front() == '-' or text.front() == '+')) {
+        text.remove_prefix(1);
+    }
+    std::size_t const point = std::min(text.find('.'), text.size());
+    std::string_view const integer_digits = text.substr(0, point);
+    std::string_view const fraction_digits =
+        point < text.size() ? text.substr(point + 1) : std::string_view{};
+    if (integer_digits.empty() and fraction_digits.empty()) {
+        return std::nullopt;
+    }
+    if (point < text.size() and fraction_digits.empty()) {
+        return std::nullopt;
+    }
+
+    // the integer part, which may take every integer bit when negative, so
+    // is checked before it's scaled up to not wrap around for wide types
+    std::uint64_t const limit = std::uint64_t{ 1 } << (integer_bits - 1);
+    std::uint64_t integer = 0;
+    for (char digit : integer_digits) {
+        if (digit < '0' or digit > '9') { return std::nullopt; }
+        auto const value = static_cast<std::uint64_t>(digit - '0');
+        if (value > limit or integer > (limit - value) / 10) {
+            return std::nullopt;
+        }
+        integer = integer * 10 + value;
+    }
+
+    // the fraction's bits come out one at a time as the carries of
+    // doubling its decimal digits, which is exact for any number of digits
+    std::string digits{ fraction_digits };
+    if (digits.find_first_not_of("0123456789") != std::string::npos) {
+        return std::nullopt;
+    }
+    auto const next_bit = [&digits] {
+        int carry = 0;
+        for (auto digit = digits.rbegin(); digit != digits.rend(); ++digit) {
+            int const doubled = (*digit - '0') * 2 + carry;
+            *digit = static_cast<char>('0' + doubled % 10);
+            carry = doubled / 10;
+        }
+        return carry;
+    };
+    std::uint64_t fraction = 0;
+    for (std::size_t bit = 0; bit < fraction_bits; ++bit) {
+        fraction = (fraction << 1) | next_bit();
+    }
+    bool const half = next_bit();
+    bool const above_half = digits.find_first_not_of('0') != std::string::npos;
+    if (half and (above_half or not negative)) { ++fraction; }
+
+    std::uint64_t const magnitude = (integer << fraction_bits) + fraction;
+    return _make_fixed<fixed_t>(magnitude, negative);
+}
+
+/**
+ * \brief Convert a double exactly into fixed point, rounding half up to the
+ *        nearest representable number like parse_fixed
+ *
+ * Scaling by a power of two is exact, and so is taking the scaled number's
+ * fraction, so the result only depends on the double's bits. toml++ parses
+ * decimal text into the nearest double.
+ */
+template<fixed_point fixed_t>
+std::optional<fixed_t> _fixed_from_double(double value)
+{
+    if (not std::isfinite(value)) { return std::nullopt; }
+    double const scaled = std::ldexp(value, fixed_t::fraction);
+    double rounded = std::floor(scaled);
+    if (scaled - rounded >= 0.5) { rounded += 1; }
+
+    double const magnitude = std::fabs(rounded);
+    if (magnitude >= 0x1p64) { return std::nullopt; }
+    return _make_fixed<fixed_t>(static_cast<std::uint64_t>(magnitude),
+                                rounded < 0);
+}
+
+/**
+ * \brief Loads fixed-point numbers from integers, floats, or decimal strings
+ *
+ * Decimal strings like "0.1" are parsed exactly, without passing through a
+ * double, for values that must match across tools and languages.
+ */
+template<std::size_t integer_bits, std::size_t fraction_bits>
+struct value_loader<fixed<integer_bits, fraction_bits>> {
+    using fixed_t = fixed<integer_bits, fraction_bits>;
+
+    static expected<fixed_t, std::string>
+    load(toml::table const & table, std::string const & variable_path)
+    {
+        toml::node const * node = table.at_path(variable_path).node();
+        if (not node) {
+            return unexpected{ _missing_variable(variable_path) };
+        }
+
+        std::optional<fixed_t> number;
+        if (auto const * integer = node->as_integer()) {
+            std::int64_t const value = integer->get();
+            std::uint64_t const magnitude = value < 0 ?
+                0 - static_cast<std::uint64_t>(value) :
+                static_cast<std::uint64_t>(value);
+            std::size_t constexpr integer_part =
+                8 * sizeof(typename fixed_t::storage_type) - fraction_bits;
+            if (magnitude <= (std::uint64_t{ 1 } << (integer_part - 1))) {
+                number = _make_fixed<fixed_t>(magnitude << fraction_bits,
+                                              value < 0);
+            }
+        }
+        else if (auto const * floating = node->as_floating_point()) {
+            number = _fixed_from_double<fixed_t>(floating->get());
+        }
+        else if (auto const * text = node->as_string()) {
+            number = parse_fixed<fixed_t>(text->get());
+        }
+        else {
+            return unexpected{ "Expecting "s + variable_path + " to be a "s
+                               "number or a decimal string, but it isn't"s };
+        }
+
+        if (not number) {
+            return unexpected{ "Expecting "s + variable_path + " to be a "s
+                               "decimal number from "s +
+                               std::to_string(fixed_t::min().to_double()) +
+                               " to "s +
+                               std::to_string(fixed_t::max().to_double()) +
+                               ", but it isn't"s };
+        }
+        return *number;
+    }
+};
+
+/*
+ * The batch operations below work on the scaled integers directly, wrapping
+ * and rounding exactly like the operators on single numbers.
+ */
+
+/**
+ * \brief Add each pair of numbers
+ *
+ * \param a         the first numbers
+ * \param b         the second numbers
+ * \param output    where to write the sums, which may be the same as either
+ *                  input
+ */
+template<fixed_point fixed_t>
+void add(std::span<fixed_t const> a, std::span<fixed_t const> b,
+         std::span<fixed_t> output)
+{
+    std::size_t const count = std::min({ a.size(), b.size(), output.size() });
+    for (std::size_t i = 0; i < count; ++i) {
+        output[i] = fixed_t::from_raw(_wrapping_add(a[i].bits(), b[i].bits()));
+    }
+}
+
+/**
+ * \brief Multiply each pair of numbers, rounding like operator*
+ */
+template<fixed_point fixed_t>
+void multiply(std::span<fixed_t const> a, std::span<fixed_t const> b,
+              std::span<fixed_t> output)
+{
+    using wide_t = typename fixed_t::wide_type;
+    using storage_t = typename fixed_t::storage_type;
+    wide_t const half = wide_t{ 1 } << (fixed_t::fraction - 1);
+
+    std::size_t const count = std::min({ a.size(), b.size(), output.size() });
+    for (std::size_t i = 0; i < count; ++i) {
+        wide_t const product = static_cast<wide_t>(a[i].bits()) * b[i].bits();
+        output[i] = fixed_t::from_raw(static_cast<storage_t>(
+                (product + half) >> fixed_t::fraction));
+    }
+}
+
+/**
+ * \brief Multiply each number by the same factor, then add an offset, like
+ *        integrating positions from velocities each tick
+ */
+template<fixed_point fixed_t>
+void multiply_add(std::span<fixed_t const> values, fixed_t factor,
+                  std::span<fixed_t const> offsets, std::span<fixed_t> output)
+{
+    using wide_t = typename fixed_t::wide_type;
+    using storage_t = typename fixed_t::storage_type;
+    wide_t const half = wide_t{ 1 } << (fixed_t::fraction - 1);
+
+    std::size_t const count =
+        std::min({ values.size(), offsets.size(), output.size() });
+    for (std::size_t i = 0; i < count; ++i) {
+        wide_t const product = static_cast<wide_t>(values[i].bits()) *
+                               factor.bits();
+        output[i] = fixed_t::from_raw(static_cast<storage_t>(
+                ((product + half) >> fixed_t::fraction) + offsets[i].bits()));
+    }
+}
+}
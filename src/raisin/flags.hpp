@@ -3,6 +3,7 @@
 // frameworks
 #include "raisin/future/expected.hpp"
 #include "raisin/lookup_table.hpp"
+#include "raisin/fundamental_types.hpp"
 
 // data types
 #include <string>
@@ -22,6 +23,7 @@
 
 // data structures
 #include <unordered_map>
+#include <optional>
 
 // serialization
 #define TOML_EXCEPTIONS 0
@@ -117,21 +119,30 @@ parse_flags(input && flag_names, table_t const & flagmap)
     return parse_flags(std::forward<input>(flag_names), is_flag, as_flag);
 }
 
+/**
+ * \brief Load flags from a node that's already been looked up
+ *
+ * \param node              the array of flag names, or null if it doesn't
+ *                          exist
+ * \param variable_path     the toml path the node was found at
+ * \param flagmap           the flag of each name
+ * \param invalid_names     a place to write any invalid names to
+ */
 template<std::size_t max_flags = limits::max_flags,
          flag_lookup lookup_t,
          std::weakly_incrementable name_output>
 requires std::indirectly_writable<name_output, std::string>
 
 expected<lookup_value_t<lookup_t>, std::string>
-load_flags(toml::table const & table,
-           std::string const & variable_path,
-           lookup_t const & flagmap,
-           name_output into_invalid_names)
+load_node_flags(toml::node const * node,
+                std::string const & variable_path,
+                lookup_t const & flagmap,
+                name_output into_invalid_names)
 {
     namespace ranges = std::ranges;
 
     std::array<std::string, max_flags> flag_names;
-    auto end_names = load_array(table, variable_path, flag_names);
+    auto end_names = load_node_array(node, variable_path, flag_names);
     if (not end_names) {
         return unexpected{ end_names.error() };
     }
@@ -144,6 +155,22 @@ load_flags(toml::table const & table,
     return result.value;
 }
 
+template<std::size_t max_flags = limits::max_flags,
+         flag_lookup lookup_t,
+         std::weakly_incrementable name_output>
+requires std::indirectly_writable<name_output, std::string>
+
+expected<lookup_value_t<lookup_t>, std::string>
+load_flags(toml::table const & table,
+           std::string const & variable_path,
+           lookup_t const & flagmap,
+           name_output into_invalid_names)
+{
+    return load_node_flags<max_flags>(table.at_path(variable_path).node(),
+                                      variable_path, flagmap,
+                                      into_invalid_names);
+}
+
 template<std::size_t max_flags = limits::max_flags,
          flag_lookup lookup_t>
 
@@ -165,28 +192,63 @@ load_flags(toml::table const & table,
     return parse_flags(loaded_names, flagmap).value;
 }
 
-template<std::unsigned_integral flag_t,
-         std::weakly_incrementable name_output,
-         std::invocable<toml::table, std::string, name_output> load_fn>
+/**
+ * \brief The loader returned by flag loaders such as load_window_flags_into
+ */
+template<std::size_t max_flags,
+         flag_lookup lookup_t,
+         std::weakly_incrementable name_output>
 requires std::indirectly_writable<name_output, std::string>
 
-auto _load_flags(load_fn && load_flags,
-                 std::string const & variable_path,
-                 flag_t & output,
-                 name_output into_invalid_names)
-{
-    return [&load_flags, &variable_path, &output, into_invalid_names]
-           (toml::table const & table)
-        -> expected<toml::table, std::string>
+struct load_flags_stage {
+    lookup_t const & flagmap;
+    std::string const & variable_path;
+    lookup_value_t<lookup_t> & output;
+    name_output into_invalid_names;
+
+    expected<toml::table, std::string>
+    operator()(toml::table const & table) const
     {
-        auto result = std::invoke(std::forward<load_fn>(load_flags),
-                                  table, variable_path,
-                                  into_invalid_names);
+        auto result = load_flags<max_flags>(table, variable_path, flagmap,
+                                            into_invalid_names);
         if (not result) {
             return unexpected(result.error());
         }
         output = *result;
         return table;
-    };
+    }
+
+    std::optional<std::string>
+    load_node(toml::table const &, toml::node const * node) const
+    {
+        auto result = load_node_flags<max_flags>(node, variable_path, flagmap,
+                                                 into_invalid_names);
+        if (not result) { return result.error(); }
+        output = *result;
+        return std::nullopt;
+    }
+};
+
+/**
+ * \brief Make a loader of flags by name
+ *
+ * \param flagmap           the flag of each name, which must outlive the
+ *                          loader
+ * \param variable_path     the toml path to the flags
+ * \param output            a reference to write the flags to
+ * \param invalid_names     a place to write any invalid names to
+ */
+template<std::size_t max_flags = limits::max_flags,
+         flag_lookup lookup_t,
+         std::weakly_incrementable name_output>
+requires std::indirectly_writable<name_output, std::string>
+
+load_flags_stage<max_flags, lookup_t, name_output>
+_load_flags(lookup_t const & flagmap,
+            std::string const & variable_path,
+            lookup_value_t<lookup_t> & output,
+            name_output into_invalid_names)
+{
+    return { flagmap, variable_path, output, into_invalid_names };
 }
 }
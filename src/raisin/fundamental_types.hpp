@@ -3,6 +3,7 @@
 
 // data types
 #include <string>
+#include <optional>
 
 // deserialization
 #define TOML_EXCEPTIONS 0
@@ -97,72 +98,107 @@ parse_file(std::string const & config_path)
     return table_result.table();
 }
 
+inline std::string _missing_variable(std::string const & variable_path)
+{
+    return "Expected the variable "s + variable_path + " to exist, "s +
+           "but it doesn't"s;
+}
+
 inline expected<toml::table, std::string>
 validate_variable(toml::table const & table,
                   std::string const & variable_path)
 {
     if (not table.at_path(variable_path)) {
-        std::string const description =
-            "Expected the variable "s + variable_path + " to exist, "s +
-            "but it doesn't"s;
-        return unexpected{ description };
+        return unexpected{ _missing_variable(variable_path) };
     }
     return table;
 }
 
 /**
- * \brief Get a subtable of a toml::table
+ * \brief Get a subtable of a toml::table without copying it
  *
  * \param table             the table to load a subtable from
  * \param variable_path     the toml path to the subtable
  *
- * \return The subtable, or a descriptive message if failed
+ * \return A pointer to the subtable, or a descriptive message if failed
  */
-inline expected<toml::table, std::string>
-subtable(toml::table const & table, std::string const & variable_path)
+inline expected<toml::table const *, std::string>
+subtable_view(toml::table const & table, std::string const & variable_path)
 {
     // make sure the table has the subtable attribute name
-    auto result = validate_variable(table, variable_path);
-    if (not result) { return unexpected(result.error()); }
+    auto const node = table.at_path(variable_path);
+    if (not node) {
+        return unexpected{ _missing_variable(variable_path) };
+    }
 
     // make sure the subtable is indeed a table
-    toml::table const * subtable = table.at_path(variable_path).as_table();
+    toml::table const * subtable = node.as_table();
     if (not subtable) {
         std::string const description =
             "Expecting "s + variable_path + " to be a table, "s +
             "but it wasn't"s;
         return unexpected{ description };
     }
-    return *subtable;
+    return subtable;
 }
 
+/**
+ * \brief Get a subtable of a toml::table
+ *
+ * \param table             the table to load a subtable from
+ * \param variable_path     the toml path to the subtable
+ *
+ * \return The subtable, or a descriptive message if failed
+ */
+inline expected<toml::table, std::string>
+subtable(toml::table const & table, std::string const & variable_path)
+{
+    auto result = subtable_view(table, variable_path);
+    if (not result) { return unexpected(result.error()); }
+    return **result;
+}
+
+/**
+ * \brief Loads values of types that aren't native
+ *
+ * Specialize this for class templates, whose load_value can't be specialized
+ * for every set of template arguments.
+ */
+template<typename value_t>
+struct value_loader {
+    static expected<value_t, std::string>
+    load(toml::table const &, std::string const &)
+    {
+        std::string const & description =
+            "Loading for type "s + typeid(value_t).name() + " is undefined"s;
+        return unexpected{ description };
+    }
+};
+
 template<typename value_t>
 expected<value_t, std::string>
 load_value(toml::table const & table, std::string const & variable_path)
 {
-    std::string const & description =
-        "Loading for type "s + typeid(value_t).name() + " is undefined"s;
-    return unexpected{ description };
+    return value_loader<value_t>::load(table, variable_path);
 }
 
 /**
- * \brief Load a native value
+ * \brief Load a native value from a node that's already been looked up
  *
- * \param table             the table to load data from
- * \param variable_path     the toml path to the variable to load
+ * \param node              the node to load, or null if it doesn't exist
+ * \param variable_path     the toml path the node was found at
  *
  * \return the loaded value, or a descriptive error message on failure
  */
 template<native value_t>
 expected<value_t, std::string>
-load_value(toml::table const & table, std::string const & variable_path)
+load_node_value(toml::node const * node, std::string const & variable_path)
 {
-    auto table_result = validate_variable(table, variable_path);
-    if (not table_result) {
-        return unexpected(table_result.error());
+    if (not node) {
+        return unexpected{ _missing_variable(variable_path) };
     }
 
-    auto value_result = table.at_path(variable_path).value<value_t>();
+    auto value_result = node->value<value_t>();
     if (not value_result) {
         std::string const description =
             "Expecting "s + variable_path + " to have type "s +
@@ -172,6 +208,22 @@ load_value(toml::table const & table, std::string const & variable_path)
     return *value_result;
 }
 
+/**
+ * \brief Load a native value
+ *
+ * \param table             the table to load data from
+ * \param variable_path     the toml path to the variable to load
+ *
+ * \return the loaded value, or a descriptive error message on failure
+ */
+template<native value_t>
+expected<value_t, std::string>
+load_value(toml::table const & table, std::string const & variable_path)
+{
+    return load_node_value<value_t>(table.at_path(variable_path).node(),
+                                    variable_path);
+}
+
 template<typename value_t>
 concept value = requires(toml::table const & table,
                          std::string const & variable_path) {
@@ -180,20 +232,45 @@ concept value = requires(toml::table const & table,
 };
 
 /**
- * \brief Load a native
+ * \brief Load a value from a node that's already been looked up
  *
- * \param variable_path     the toml path to the variable to load
- * \param output            where to write the loaded value to
+ * \param table             the table the node was found in
+ * \param node              the node to load, or null if it doesn't exist
+ * \param variable_path     the toml path the node was found at
  *
- * \return a function taking a toml::table and returning an expected table
- *         result, such that the target value is written to val when loading
- *         is successful.
+ * \note Only native values are loaded from the node directly. Other values
+ *       are loaded from the table with their load_value specialization.
  */
 template<value value_t>
-auto load(std::string const & variable_path, value_t & output)
+expected<value_t, std::string>
+load_node_value(toml::table const & table, toml::node const * node,
+                std::string const & variable_path)
 {
-    return [&variable_path, &output](toml::table const & table)
-        -> expected<toml::table, std::string>
+    if constexpr (native<value_t>) {
+        return load_node_value<value_t>(node, variable_path);
+    }
+    else {
+        if (not node) {
+            return unexpected{ _missing_variable(variable_path) };
+        }
+        return load_value<value_t>(table, variable_path);
+    }
+}
+
+/**
+ * \brief The loader returned by load
+ *
+ * Besides loading from a table, a stage can load from a node that's already
+ * been found, so that pipelines of stages can be fused into a single pass
+ * over a table (see raisin/pipeline.hpp).
+ */
+template<value value_t>
+struct load_stage {
+    std::string const & variable_path;
+    value_t & output;
+
+    expected<toml::table, std::string>
+    operator()(toml::table const & table) const
     {
         auto result = load_value<value_t>(table, variable_path);
         if (not result) {
@@ -201,7 +278,32 @@ auto load(std::string const & variable_path, value_t & output)
         }
         output = *result;
         return table;
-    };
+    }
+
+    std::optional<std::string>
+    load_node(toml::table const & table, toml::node const * node) const
+    {
+        auto result = load_node_value<value_t>(table, node, variable_path);
+        if (not result) { return result.error(); }
+        output = *result;
+        return std::nullopt;
+    }
+};
+
+/**
+ * \brief Load a native
+ *
+ * \param variable_path     the toml path to the variable to load
+ * \param output            where to write the loaded value to
+ *
+ * \return a function taking a toml::table and returning an expected table
+ *         result, such that the target value is written to val when loading
+ *         is successful.
+ */
+template<value value_t>
+load_stage<value_t> load(std::string const & variable_path, value_t & output)
+{
+    return { variable_path, output };
 }
 
 /**
@@ -225,6 +327,30 @@ value_t load_value_or_else(toml::table const & table,
     return *result;
 }
 
+/**
+ * \brief The loader returned by load_or_else
+ */
+template<value value_t>
+struct load_or_else_stage {
+    std::string const & variable_path;
+    value_t & output;
+    value_t default_val;
+
+    toml::table operator()(toml::table const & table) const
+    {
+        output = load_value_or_else(table, variable_path, default_val);
+        return table;
+    }
+
+    std::optional<std::string>
+    load_node(toml::table const & table, toml::node const * node) const
+    {
+        auto result = load_node_value<value_t>(table, node, variable_path);
+        output = result ? *result : default_val;
+        return std::nullopt;
+    }
+};
+
 /**
  * \brief Load a native type
  *
@@ -237,16 +363,12 @@ value_t load_value_or_else(toml::table const & table,
  *         unsuccessful.
  */
 template<value value_t>
-auto load_or_else(std::string const & variable_path,
-                  value_t & output,
-                  value_t const & default_val)
+load_or_else_stage<value_t>
+load_or_else(std::string const & variable_path,
+             value_t & output,
+             value_t const & default_val)
 {
-    return [&variable_path, &output, default_val]
-           (toml::table const & table)
-    {
-        output = load_value_or_else(table, variable_path, default_val);
-        return table;
-    };
+    return { variable_path, output, default_val };
 }
 
 template<typename range_t>
@@ -259,31 +381,30 @@ concept output_range = std::ranges::output_range<range_t, value_t> and
                        value<value_t>;
 
 /**
- * \brief Load an array of native types
+ * \brief Load an array of native types from a node that's already been
+ *        looked up
  *
- * \param table             the table with the array to load
- * \param variable_path     the toml path to the array
+ * \param node              the node to load, or null if it doesn't exist
+ * \param variable_path     the toml path the node was found at
  * \param into_array        where to write values to
  *
  * \return the iterator to the next unwritten element
  */
 template<opaque_output_range range_t>
 expected<std::ranges::iterator_t<range_t>, std::string>
-load_array(toml::table const & table,
-           std::string const & variable_path,
-           range_t && array)
+load_node_array(toml::node const * node,
+                std::string const & variable_path,
+                range_t && array)
 {
     namespace ranges = std::ranges;
-    auto result = validate_variable(table, variable_path);
-    if (not result) {
-        return unexpected(result.error());
+    if (not node) {
+        return unexpected{ _missing_variable(variable_path) };
     }
-    auto node = table.at_path(variable_path);
-    if (not node.is_array()) {
+    if (not node->is_array()) {
         std::string const description = variable_path + " must be an array"s;
         return unexpected{ description };
     }
-    auto arr = *node.as_array();
+    auto const & arr = *node->as_array();
     using value_t = ranges::range_value_t<range_t>;
     // TODO: make this work for non-native types
     // if (not arr.is_homogeneous(node_type_v<value_t>)) {
@@ -306,4 +427,23 @@ load_array(toml::table const & table,
     });
     return it;
 }
+
+/**
+ * \brief Load an array of native types
+ *
+ * \param table             the table with the array to load
+ * \param variable_path     the toml path to the array
+ * \param into_array        where to write values to
+ *
+ * \return the iterator to the next unwritten element
+ */
+template<opaque_output_range range_t>
+expected<std::ranges::iterator_t<range_t>, std::string>
+load_array(toml::table const & table,
+           std::string const & variable_path,
+           range_t && array)
+{
+    return load_node_array(table.at_path(variable_path).node(), variable_path,
+                           std::forward<range_t>(array));
+}
 }
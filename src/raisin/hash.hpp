@@ -0,0 +1,326 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+
+// data structures
+#include <map>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin {
+
+using namespace std::string_literals;
+
+inline std::uint64_t constexpr _hash_multiplier = 0x9e3779b97f4a7c15ull;
+
+inline std::uint64_t _hash_mix(std::uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebull;
+    value ^= value >> 31;
+    return value;
+}
+
+/**
+ * \brief Combine a hash with another value, order dependently
+ */
+inline std::uint64_t hash_combine(std::uint64_t seed, std::uint64_t value)
+{
+    return _hash_mix(seed + _hash_multiplier + std::rotl(value, 23));
+}
+
+/**
+ * \brief A fast, non-cryptographic 64-bit hash of some bytes
+ *
+ * \note Bytes are read as little-endian words on every platform, so the hash
+ *       of the same bytes is the same across runs and machines.
+ */
+inline std::uint64_t hash_bytes(std::string_view bytes, std::uint64_t seed = 0)
+{
+    std::uint64_t hash = _hash_mix(seed ^ (bytes.size() * _hash_multiplier));
+    auto const * data = reinterpret_cast<unsigned char const *>(bytes.data());
+    std::size_t remaining = bytes.size();
+
+    auto const read_word = [](unsigned char const * data, std::size_t size) {
+        std::uint64_t word = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            word |= std::uint64_t{ data[i] } << (8 * i);
+        }
+        return word;
+    };
+
+    for (; remaining >= 8; remaining -= 8, data += 8) {
+        hash = hash_combine(hash, read_word(data, 8));
+    }
+    if (remaining > 0) {
+        hash = hash_combine(hash, read_word(data, remaining));
+    }
+    return _hash_mix(hash);
+}
+
+namespace _node_tag {
+std::uint64_t constexpr table = 1;
+std::uint64_t constexpr array = 2;
+std::uint64_t constexpr string = 3;
+std::uint64_t constexpr integer = 4;
+std::uint64_t constexpr floating_point = 5;
+std::uint64_t constexpr boolean = 6;
+std::uint64_t constexpr date = 7;
+std::uint64_t constexpr time = 8;
+std::uint64_t constexpr date_time = 9;
+}
+
+inline std::uint64_t _hash_date(toml::date const & date)
+{
+    return (std::uint64_t{ date.year } << 16) |
+           (std::uint64_t{ date.month } << 8) | date.day;
+}
+
+inline std::uint64_t _hash_time(toml::time const & time)
+{
+    return (std::uint64_t{ time.hour } << 48) |
+           (std::uint64_t{ time.minute } << 40) |
+           (std::uint64_t{ time.second } << 32) | time.nanosecond;
+}
+
+/**
+ * \brief Hash a leaf node of a toml document
+ *
+ * \note Tables and arrays are hashed from their children's hashes, so they
+ *       can't be hashed with this function.
+ */
+inline std::uint64_t hash_value(toml::node const & node)
+{
+    namespace tag = _node_tag;
+    switch (node.type()) {
+    case toml::node_type::string:
+        return hash_bytes(node.as_string()->get(), tag::string);
+    case toml::node_type::integer:
+        return hash_combine(tag::integer, static_cast<std::uint64_t>(
+                    node.as_integer()->get()));
+    case toml::node_type::floating_point: {
+        double value = node.as_floating_point()->get();
+        if (value == 0.0) { value = 0.0; }   // so that -0.0 hashes as 0.0
+        return hash_combine(tag::floating_point,
+                            std::bit_cast<std::uint64_t>(value));
+    }
+    case toml::node_type::boolean:
+        return hash_combine(tag::boolean, node.as_boolean()->get());
+    case toml::node_type::date:
+        return hash_combine(tag::date, _hash_date(
+                    node.as_date()->get()));
+    case toml::node_type::time:
+        return hash_combine(tag::time, _hash_time(
+                    node.as_time()->get()));
+    case toml::node_type::date_time: {
+        auto const & date_time = node.as_date_time()->get();
+        std::uint64_t hash = hash_combine(tag::date_time,
+                                          _hash_date(date_time.date));
+        hash = hash_combine(hash, _hash_time(date_time.time));
+        if (date_time.offset) {
+            hash = hash_combine(hash, static_cast<std::uint64_t>(
+                        date_time.offset->minutes));
+        }
+        return hash;
+    }
+    default:
+        return 0;
+    }
+}
+
+/**
+ * \brief Hash a node and everything beneath it
+ *
+ * Tables hash each of their keys along with their value's hash, in key order,
+ * and arrays hash their values' hashes in order. Two subtrees have the same
+ * hash if they have the same content, regardless of where they are.
+ */
+inline std::uint64_t subtree_hash(toml::node const & node)
+{
+    if (auto const * table = node.as_table()) {
+        std::uint64_t hash = hash_combine(_node_tag::table, table->size());
+        for (auto && [key, value] : *table) {
+            hash = hash_combine(hash, hash_bytes(key.str()));
+            hash = hash_combine(hash, subtree_hash(value));
+        }
+        return hash;
+    }
+    if (auto const * array = node.as_array()) {
+        std::uint64_t hash = hash_combine(_node_tag::array, array->size());
+        for (toml::node const & value : *array) {
+            hash = hash_combine(hash, subtree_hash(value));
+        }
+        return hash;
+    }
+    return hash_value(node);
+}
+
+/**
+ * \brief Hash the subtree at a path in a table
+ *
+ * \param table             the table with the subtree
+ * \param variable_path     the toml path to the subtree
+ *
+ * \return the hash of the subtree, or a descriptive error message if it
+ *         doesn't exist
+ */
+inline expected<std::uint64_t, std::string>
+subtree_hash(toml::table const & table, std::string const & variable_path)
+{
+    if (variable_path.empty()) { return subtree_hash(table); }
+
+    toml::node const * node = table.at_path(variable_path).node();
+    if (not node) {
+        return unexpected{ _missing_variable(variable_path) };
+    }
+    return subtree_hash(*node);
+}
+
+/**
+ * \brief A cache of the subtree hashes of a toml document
+ *
+ * The hash of every table and array is cached by its path the first time
+ * it's needed, so hashing a subtree again, or hashing a parent of a hashed
+ * subtree, only hashes what hasn't been hashed yet.
+ *
+ * After editing the document, invalidate the path of each edited node. Only
+ * that node's subtree and its ancestors are rehashed, so cached hashes of
+ * everything else are reused:
+ *
+ *      raisin::merkle_tree hashes{ config };
+ *      if (hashes.subtree_hash("atlas") != cached_atlas_hash) { rebake(); }
+ *
+ *      config.at_path("atlas.padding").as_integer()->get() = 4;
+ *      hashes.invalidate("atlas.padding");
+ *
+ * Inserting or erasing an array element shifts the indices of the elements
+ * after it, so invalidating an element's path forgets every element of its
+ * array. Invalidate the array itself after a structural edit made elsewhere.
+ *
+ * \note The tree refers to the document, so the document must outlive it.
+ */
+class merkle_tree {
+public:
+    explicit merkle_tree(toml::table const & root)
+        : root{ root }
+    {
+    }
+
+    /**
+     * \brief Get the hash of a subtree, hashing only what isn't cached
+     *
+     * \param variable_path     the toml path to the subtree, or the empty
+     *                          string for the whole document
+     *
+     * \return the same hash as the free subtree_hash, or a descriptive error
+     *         message if the subtree doesn't exist
+     */
+    expected<std::uint64_t, std::string>
+    subtree_hash(std::string const & variable_path)
+    {
+        if (variable_path.empty()) { return hash_node(root, ""s); }
+
+        toml::node const * node = root.at_path(variable_path).node();
+        if (not node) {
+            return unexpected{ _missing_variable(variable_path) };
+        }
+        std::string path = variable_path;
+        return hash_node(*node, path);
+    }
+
+    /**
+     * \brief Forget the hashes of an edited node and everything that
+     *        depends on it
+     *
+     * \param variable_path     the toml path of the node that was added,
+     *                          removed or changed
+     */
+    void invalidate(std::string const & variable_path)
+    {
+        erase_prefixed(variable_path + "."s);
+        erase_prefixed(variable_path + "["s);
+
+        // an element added to or removed from an array moves its siblings to
+        // other indices, so their cached hashes are of other elements now
+        if (variable_path.ends_with(']')) {
+            auto const index = variable_path.find_last_of('[');
+            if (index != std::string::npos) {
+                erase_prefixed(variable_path.substr(0, index + 1));
+            }
+        }
+
+        // ancestors are each prefix of the path that ends at a separator
+        std::string_view path = variable_path;
+        while (true) {
+            hashes.erase(std::string{ path });
+            auto const separator = path.find_last_of(".[");
+            if (path.empty()) { break; }
+            path = separator == std::string_view::npos ?
+                std::string_view{} : path.substr(0, separator);
+        }
+    }
+
+    /**
+     * \brief Forget every cached hash
+     */
+    void clear() { hashes.clear(); }
+
+private:
+    toml::table const & root;
+    std::map<std::string, std::uint64_t, std::less<>> hashes;
+
+    void erase_prefixed(std::string const & prefix)
+    {
+        auto const first = hashes.lower_bound(prefix);
+        auto last = first;
+        while (last != hashes.end() and last->first.starts_with(prefix)) {
+            ++last;
+        }
+        hashes.erase(first, last);
+    }
+
+    std::uint64_t hash_node(toml::node const & node, std::string path)
+    {
+        auto const * table = node.as_table();
+        auto const * array = node.as_array();
+        if (not table and not array) { return hash_value(node); }
+
+        if (auto cached = hashes.find(path); cached != hashes.end()) {
+            return cached->second;
+        }
+
+        std::uint64_t hash;
+        if (table) {
+            hash = hash_combine(_node_tag::table, table->size());
+            for (auto && [key, value] : *table) {
+                std::string child_path = path.empty() ?
+                    key.str() : path + "."s + key.str();
+                hash = hash_combine(hash, hash_bytes(key.str()));
+                hash = hash_combine(hash, hash_node(value, child_path));
+            }
+        }
+        else {
+            hash = hash_combine(_node_tag::array, array->size());
+            std::size_t index = 0;
+            for (toml::node const & value : *array) {
+                std::string child_path =
+                    path + "["s + std::to_string(index++) + "]"s;
+                hash = hash_combine(hash, hash_node(value, child_path));
+            }
+        }
+        hashes.emplace(std::move(path), hash);
+        return hash;
+    }
+};
+}
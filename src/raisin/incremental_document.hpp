@@ -0,0 +1,236 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/sections.hpp"
+#include "raisin/hash.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+// data structures
+#include <map>
+#include <set>
+#include <vector>
+#include <optional>
+#include <utility>
+
+// algorithms
+#include <algorithm>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin {
+
+using namespace std::string_literals;
+
+/**
+ * \brief A toml document that re-parses only the sections that changed
+ *
+ * Each reload splits the new text by top-level header and hashes the text of
+ * each top-level table. Tables whose text is unchanged keep their parsed
+ * subtree; only the others are parsed, so reloading after an edit costs about
+ * as much as parsing the edited tables.
+ *
+ *      raisin::incremental_document config;
+ *      auto changed = config.reload_file("assets/config.toml");
+ *      if (changed) {
+ *          for (auto const & key : *changed) { hashes.invalidate(key); }
+ *      }
+ *
+ * \note Sections are grouped by the first key of their header the same way as
+ *       lazy_document, so all of a top-level table's sections are re-parsed
+ *       together if any of them changes. Key-value pairs before the first
+ *       header are one more group. Groups that define the same top-level
+ *       table, like a.x = 1 before [a.b], are parsed and re-parsed together.
+ */
+class incremental_document {
+public:
+    incremental_document() = default;
+
+    /**
+     * \brief Parse a document, reusing what didn't change since the last
+     *        reload
+     *
+     * \param text          the new text of the document
+     * \param source_path   the path of the document, for error messages
+     *
+     * \return the top-level keys that were added, removed or changed, or a
+     *         descriptive message if the new text failed to parse, in which
+     *         case the document is left as it was
+     */
+    expected<std::vector<std::string>, std::string>
+    reload(std::string_view text, std::string const & source_path = ""s)
+    {
+        std::map<std::string, std::vector<toml_section>, std::less<>> sections;
+        for (toml_section const & section : split_sections(text)) {
+            sections[std::string{ section.key }].push_back(section);
+        }
+
+        // start from the groups the last reload parsed together, so that
+        // groups which had to be merged don't have to be found again
+        std::vector<std::vector<std::string>> members;
+        std::set<std::string, std::less<>> placed;
+        for (auto const & [names, previous] : units) {
+            std::vector<std::string> kept;
+            for (std::string const & name : names) {
+                if (sections.contains(name)) { kept.push_back(name); }
+            }
+            if (kept.empty()) { continue; }
+            placed.insert(kept.begin(), kept.end());
+            members.push_back(std::move(kept));
+        }
+        for (auto const & [key, group_sections] : sections) {
+            if (not placed.contains(key)) { members.push_back({ key }); }
+        }
+
+        // parse every changed unit before touching the document, so that a
+        // failed reload leaves it as it was
+        std::map<std::vector<std::string>, unit> next;
+        std::map<std::vector<std::string>, toml::table> parsed;
+        auto const load = [&](std::vector<std::string> const & names)
+            -> expected<void, std::string>
+        {
+            if (next.contains(names)) { return {}; }
+
+            std::uint64_t hash = 0;
+            std::vector<toml_section> unit_sections;
+            for (std::string const & name : names) {
+                auto const & group = sections.find(name)->second;
+                for (toml_section const & section : group) {
+                    hash = hash_combine(hash, hash_bytes(text.substr(
+                            section.begin, section.end - section.begin)));
+                    unit_sections.push_back(section);
+                }
+            }
+
+            auto const previous = units.find(names);
+            if (previous != units.end() and previous->second.hash == hash) {
+                next.emplace(names, previous->second);
+                return {};
+            }
+
+            std::ranges::sort(unit_sections, {}, &toml_section::begin);
+            auto result = parse_sections(text, unit_sections, source_path);
+            if (not result) { return unexpected(result.error()); }
+
+            unit added{ hash, {} };
+            for (auto && [key, value] : *result) {
+                added.keys.push_back(key.str());
+            }
+            next.emplace(names, std::move(added));
+            parsed.emplace(names, std::move(*result));
+            return {};
+        };
+
+        // groups that define the same top-level key, as a.x = 1 before the
+        // first header does with [a.b], only parse correctly together, so
+        // merge them until every key has one unit
+        for (;;) {
+            for (auto const & names : members) {
+                auto const loaded = load(names);
+                if (not loaded) { return unexpected(loaded.error()); }
+            }
+
+            std::map<std::string, std::size_t, std::less<>> owners;
+            std::optional<std::pair<std::size_t, std::size_t>> shared;
+            for (std::size_t i = 0; i < members.size() and not shared; ++i) {
+                auto const & keys = next.find(members[i])->second.keys;
+                for (std::string const & key : keys) {
+                    auto const [owner, inserted] = owners.emplace(key, i);
+                    if (not inserted) {
+                        shared.emplace(owner->second, i);
+                        break;
+                    }
+                }
+            }
+            if (not shared) { break; }
+
+            auto & into = members[shared->first];
+            auto & from = members[shared->second];
+            into.insert(into.end(), from.begin(), from.end());
+            std::ranges::sort(into);
+            members.erase(members.begin() +
+                          static_cast<std::ptrdiff_t>(shared->second));
+        }
+
+        // drop the units that were merged into others
+        auto const merged_away = [&members](auto const & entry) {
+            return std::ranges::find(members, entry.first) == members.end();
+        };
+        std::erase_if(next, merged_away);
+        std::erase_if(parsed, merged_away);
+
+        std::vector<std::string> changed;
+        for (auto const & [names, previous] : units) {
+            if (next.contains(names) and not parsed.contains(names)) {
+                continue;
+            }
+            for (std::string const & key : previous.keys) {
+                document.erase(key);
+                changed.push_back(key);
+            }
+        }
+        for (auto & [names, parsed_table] : parsed) {
+            for (auto && [key, value] : parsed_table) {
+                changed.push_back(key.str());
+                value.visit([this, &key](auto & value) {
+                    document.insert_or_assign(key.str(), std::move(value));
+                });
+            }
+        }
+        units = std::move(next);
+        ++reloads;
+
+        std::ranges::sort(changed);
+        auto const [first, last] = std::ranges::unique(changed);
+        changed.erase(first, last);
+        return changed;
+    }
+
+    /**
+     * \brief Read a file and reload the document from it
+     *
+     * \param config_path   the path to the file
+     *
+     * \return the top-level keys that were added, removed or changed, or a
+     *         descriptive message if the file couldn't be read or parsed
+     */
+    expected<std::vector<std::string>, std::string>
+    reload_file(std::string const & config_path)
+    {
+        auto text = read_text_file(config_path);
+        if (not text) { return unexpected(text.error()); }
+        return reload(*text, config_path);
+    }
+
+    /**
+     * \brief The parsed document, as of the last successful reload
+     */
+    toml::table const & table() const { return document; }
+
+    /**
+     * \brief The number of successful reloads
+     */
+    std::size_t generation() const { return reloads; }
+
+private:
+    // groups of sections that are parsed together
+    struct unit {
+        // the combined hash of the text of the unit's sections
+        std::uint64_t hash = 0;
+
+        // the top-level keys the unit defines in the document
+        std::vector<std::string> keys;
+    };
+
+    toml::table document;
+
+    // the units of the last reload, by the sorted keys of their groups
+    std::map<std::vector<std::string>, unit> units;
+    std::size_t reloads = 0;
+};
+}
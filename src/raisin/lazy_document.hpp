@@ -0,0 +1,194 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+#include "raisin/sections.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// data structures
+#include <map>
+#include <vector>
+#include <optional>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin {
+
+using namespace std::string_literals;
+
+/**
+ * \brief A toml document whose top-level tables are parsed on first use
+ *
+ * Opening a document only reads it and scans it for its top-level headers.
+ * Each top-level table is parsed the first time a path into it is loaded,
+ * and is cached after that, so a tool that reads one section of a large
+ * config only pays to parse that section.
+ *
+ *      auto document = raisin::lazy_document::open("assets/levels.toml");
+ *      auto width = document.and_then([](auto & document) {
+ *          return raisin::load_value<int>(document, "level-3.width");
+ *      });
+ *
+ * Key-value pairs before the first header are parsed together the first
+ * time any key is loaded. A top-level table they define that also has a
+ * header, as a.x = 1 does for [a.b], is parsed together with them.
+ *
+ * \note Sections are grouped by the first key of their header, so [a] and
+ *       [a.b] are parsed together even when they aren't next to each other.
+ *       Quoted header keys with escape sequences are grouped by their quoted
+ *       text, and so must be looked up the same way.
+ */
+class lazy_document {
+public:
+    /**
+     * \brief Scan the text of a toml document
+     */
+    explicit lazy_document(std::string text,
+                           std::string source_path = ""s)
+        : text{ std::move(text) }, source_path{ std::move(source_path) }
+    {
+        for (toml_section const & section : split_sections(this->text)) {
+            group & found = groups[std::string{ section.key }];
+            found.sections.push_back(section);
+        }
+    }
+
+    /**
+     * \brief Read and scan a toml file
+     *
+     * \param config_path   the path to the file
+     *
+     * \return the scanned document, or a descriptive message if the file
+     *         couldn't be read
+     */
+    static expected<lazy_document, std::string>
+    open(std::string const & config_path)
+    {
+        auto text = read_text_file(config_path);
+        if (not text) { return unexpected(text.error()); }
+        return lazy_document{ std::move(*text), config_path };
+    }
+
+    /**
+     * \brief Get the root table that a path can be loaded from
+     *
+     * \param variable_path     the toml path to load
+     *
+     * \return a root table that holds the top-level table of the path, parsing
+     *         it if it hasn't been parsed yet, or a descriptive message if it
+     *         failed to parse
+     */
+    expected<toml::table const *, std::string>
+    root_for(std::string_view variable_path)
+    {
+        std::string_view const key = variable_path.substr(
+                0, variable_path.find_first_of(".["));
+
+        auto const preamble = groups.find(""s);
+        auto const found = key.empty() ? groups.end() : groups.find(key);
+        if (found == groups.end()) {
+            if (preamble == groups.end()) { return &empty; }
+            return parse(preamble->second);
+        }
+
+        if (preamble == groups.end()) { return parse(found->second); }
+
+        // dotted keys or an inline table before the first header, like
+        // a.x = 1, can define the same table as a header, like [a.b], and
+        // then only parse correctly together with it
+        auto pairs = parse(preamble->second);
+        if (not pairs) { return pairs; }
+        if (not (*pairs)->contains(key)) { return parse(found->second); }
+        return parse_with(found->second, preamble->second);
+    }
+
+    /**
+     * \brief The number of top-level tables that have been parsed
+     */
+    std::size_t parsed() const
+    {
+        std::size_t count = 0;
+        for (auto const & [key, group] : groups) {
+            if (group.table or group.with_preamble) { ++count; }
+        }
+        return count;
+    }
+
+private:
+    struct group {
+        std::vector<toml_section> sections;
+        std::optional<toml::table> table;
+
+        // the group parsed with the key-value pairs before the first header,
+        // when those define its top-level table too
+        std::optional<toml::table> with_preamble;
+    };
+
+    std::string text;
+    std::string source_path;
+    std::map<std::string, group, std::less<>> groups;
+    toml::table empty;
+
+    expected<toml::table const *, std::string> parse(group & group)
+    {
+        if (group.table) { return &*group.table; }
+
+        auto result = parse_sections(text, group.sections, source_path);
+        if (not result) { return unexpected(result.error()); }
+        group.table = std::move(*result);
+        return &*group.table;
+    }
+
+    expected<toml::table const *, std::string>
+    parse_with(group & found, group const & preamble)
+    {
+        if (found.with_preamble) { return &*found.with_preamble; }
+
+        std::vector<toml_section> sections = preamble.sections;
+        sections.insert(sections.end(),
+                        found.sections.begin(), found.sections.end());
+        auto result = parse_sections(text, sections, source_path);
+        if (not result) { return unexpected(result.error()); }
+        found.with_preamble = std::move(*result);
+        return &*found.with_preamble;
+    }
+};
+
+/**
+ * \brief Get a subtable of a lazily parsed document
+ *
+ * \param document          the document to load a subtable from
+ * \param variable_path     the toml path to the subtable
+ *
+ * \return The subtable, or a descriptive message if failed
+ */
+inline expected<toml::table, std::string>
+subtable(lazy_document & document, std::string const & variable_path)
+{
+    auto root = document.root_for(variable_path);
+    if (not root) { return unexpected(root.error()); }
+    return subtable(**root, variable_path);
+}
+
+/**
+ * \brief Load a value from a lazily parsed document
+ *
+ * \param document          the document to load data from
+ * \param variable_path     the toml path to the variable to load
+ *
+ * \return the loaded value, or a descriptive error message on failure
+ */
+template<value value_t>
+expected<value_t, std::string>
+load_value(lazy_document & document, std::string const & variable_path)
+{
+    auto root = document.root_for(variable_path);
+    if (not root) { return unexpected(root.error()); }
+    return load_value<value_t>(**root, variable_path);
+}
+}
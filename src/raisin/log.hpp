@@ -0,0 +1,442 @@
+#pragma once
+#include "raisin/future.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <bit>
+
+// data structures
+#include <array>
+#include <vector>
+#include <memory>
+#include <utility>
+
+// algorithms
+#include <algorithm>
+
+// type constraints
+#include <concepts>
+#include <type_traits>
+#include <iterator>
+
+// concurrency
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+// i/o
+#include <ostream>
+
+namespace raisin {
+
+namespace limits {
+std::size_t constexpr log_record_size = 128;
+std::size_t constexpr log_ring_capacity = 1024;
+}
+
+using log_format_id = std::uint16_t;
+
+/**
+ * \brief A fixed-size, binary encoded log message.
+ *
+ * Arguments are stored back to back in the payload as a one byte tag followed
+ * by either eight bytes for numbers, or a one byte length and the characters
+ * for strings. Strings that don't fit in the remaining payload are truncated.
+ */
+struct log_record {
+    enum class tag : std::uint8_t {
+        signed_integer, unsigned_integer, floating_point, boolean, string
+    };
+
+    static std::size_t constexpr header_size = sizeof(log_format_id) + 2;
+    static std::size_t constexpr payload_size =
+        limits::log_record_size - header_size;
+
+    log_format_id format = 0;
+    std::uint8_t size = 0;
+    std::uint8_t count = 0;
+    std::array<char, payload_size> payload;
+
+    template<typename number_t>
+    bool push_number(tag type, number_t value)
+    {
+        if (size + 1u + sizeof(number_t) > payload_size) { return false; }
+        payload[size++] = static_cast<char>(type);
+        std::memcpy(payload.data() + size, &value, sizeof(number_t));
+        size += sizeof(number_t);
+        ++count;
+        return true;
+    }
+
+    bool push_string(std::string_view value)
+    {
+        if (size + 2u > payload_size) { return false; }
+        std::size_t const length =
+            std::min(value.size(), payload_size - size - 2);
+
+        payload[size++] = static_cast<char>(tag::string);
+        payload[size++] = static_cast<char>(length);
+        std::memcpy(payload.data() + size, value.data(), length);
+        size += length;
+        ++count;
+        return true;
+    }
+
+    template<typename value_t>
+    bool push(value_t const & value)
+    {
+        if constexpr (std::same_as<value_t, bool>) {
+            return push_number(tag::boolean, std::uint8_t{ value });
+        }
+        else if constexpr (std::signed_integral<value_t>) {
+            return push_number(tag::signed_integer,
+                               static_cast<std::int64_t>(value));
+        }
+        else if constexpr (std::unsigned_integral<value_t>) {
+            return push_number(tag::unsigned_integer,
+                               static_cast<std::uint64_t>(value));
+        }
+        else if constexpr (std::floating_point<value_t>) {
+            return push_number(tag::floating_point,
+                               static_cast<double>(value));
+        }
+        else {
+            static_assert(std::convertible_to<value_t const &,
+                                              std::string_view>,
+                          "log arguments must be numbers or strings");
+            return push_string(std::string_view{ value });
+        }
+    }
+};
+static_assert(sizeof(log_record) == limits::log_record_size);
+
+/**
+ * \brief A single-producer, single-consumer ring of log records.
+ */
+class log_ring {
+public:
+    explicit log_ring(std::size_t capacity)
+        : records{ std::make_unique<log_record[]>(capacity) },
+          mask{ capacity - 1 }
+    {
+    }
+
+    bool try_push(log_record const & record) noexcept
+    {
+        std::size_t const tail = tail_index.load(std::memory_order_relaxed);
+        if (tail - head_index.load(std::memory_order_acquire) > mask) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        records[tail & mask] = record;
+        tail_index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(log_record & record) noexcept
+    {
+        std::size_t const head = head_index.load(std::memory_order_relaxed);
+        if (head == tail_index.load(std::memory_order_acquire)) {
+            return false;
+        }
+        record = records[head & mask];
+        head_index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::size_t pushed() const noexcept
+    {
+        return tail_index.load(std::memory_order_acquire);
+    }
+
+    alignas(64) std::atomic<std::size_t> dropped{ 0 };
+
+private:
+    alignas(64) std::atomic<std::size_t> head_index{ 0 };
+    alignas(64) std::atomic<std::size_t> tail_index{ 0 };
+    std::unique_ptr<log_record[]> records;
+    std::size_t mask;
+};
+
+class log_sink;
+
+/**
+ * \brief An output iterator that logs every name written to it
+ *
+ * This can be used as the name_output for any flag loader, so that invalid
+ * names are reported without being collected into a container first.
+ */
+class log_name_output {
+public:
+    using difference_type = std::ptrdiff_t;
+
+    log_name_output() = default;
+    log_name_output(log_sink & sink, log_format_id format)
+        : sink{ &sink }, format{ format }
+    {
+    }
+
+    log_name_output & operator*() { return *this; }
+    log_name_output & operator++() { return *this; }
+    log_name_output operator++(int) { return *this; }
+
+    log_name_output & operator=(std::string_view name);
+
+private:
+    log_sink * sink = nullptr;
+    log_format_id format = 0;
+};
+
+/**
+ * \brief An asynchronous log that formats and writes on a background thread
+ *
+ * Each thread that writes to the sink gets its own lock-free ring of binary
+ * records, so writing a message only encodes its arguments and copies the
+ * record into the ring. Formatting and i/o happen on the sink's thread.
+ *
+ * \note When a thread's ring is full, its messages are dropped and counted
+ *       rather than blocking the caller.
+ *
+ * Format patterns substitute each "{}" with the next argument, e.g.
+ *
+ *      raisin::log_sink log{ std::cerr };
+ *      auto const bad_flag = log.format("No window flag named {}, skipping");
+ *      log.write(bad_flag, "fulscreen");
+ */
+class log_sink {
+public:
+    explicit log_sink(std::ostream & output,
+                      std::size_t ring_capacity = limits::log_ring_capacity)
+        : output{ output },
+          ring_capacity{ std::bit_ceil(std::max<std::size_t>(ring_capacity,
+                                                             2)) },
+          id{ next_id() },
+          worker{ [this] { run(); } }
+    {
+    }
+
+    log_sink(log_sink const &) = delete;
+    log_sink & operator=(log_sink const &) = delete;
+
+    ~log_sink()
+    {
+        running.store(false, std::memory_order_release);
+        worker.join();
+    }
+
+    /**
+     * \brief Register a format pattern
+     *
+     * \param pattern   the message to write, with "{}" for each argument
+     *
+     * \return the id to write messages of this format with
+     */
+    log_format_id format(std::string_view pattern)
+    {
+        std::scoped_lock lock{ formats_mutex };
+        formats.emplace_back(pattern);
+        return static_cast<log_format_id>(formats.size() - 1);
+    }
+
+    /**
+     * \brief Log a message without blocking on i/o
+     *
+     * \param format    the id of a pattern registered with this sink
+     * \param args      numbers or strings to substitute into the pattern
+     */
+    template<typename... args_t>
+    void write(log_format_id format, args_t const &... args)
+    {
+        log_record record;
+        record.format = format;
+        (record.push(args) and ...);
+        local_ring().try_push(record);
+    }
+
+    /**
+     * \brief Get an output iterator that logs each name with a pattern
+     */
+    log_name_output names(log_format_id format)
+    {
+        return log_name_output{ *this, format };
+    }
+
+    /**
+     * \brief Block until every message written so far has been written out
+     */
+    void flush()
+    {
+        std::size_t pushed = 0;
+        {
+            std::scoped_lock lock{ rings_mutex };
+            for (auto const & ring : rings) { pushed += ring->pushed(); }
+        }
+        while (written.load(std::memory_order_acquire) < pushed) {
+            std::this_thread::sleep_for(std::chrono::microseconds{ 100 });
+        }
+    }
+
+    /**
+     * \brief The number of messages dropped because a ring was full
+     */
+    std::size_t dropped() const
+    {
+        std::scoped_lock lock{ rings_mutex };
+        std::size_t total = 0;
+        for (auto const & ring : rings) {
+            total += ring->dropped.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    std::ostream & output;
+    std::size_t const ring_capacity;
+    std::uint64_t const id;
+
+    mutable std::mutex rings_mutex;
+    std::vector<std::unique_ptr<log_ring>> rings;
+
+    std::mutex formats_mutex;
+    std::vector<std::string> formats;
+
+    std::atomic<std::size_t> written{ 0 };
+    std::atomic<bool> running{ true };
+    std::thread worker;
+
+    static std::uint64_t next_id()
+    {
+        static std::atomic<std::uint64_t> count{ 0 };
+        return count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    log_ring & local_ring()
+    {
+        // sinks are identified by id rather than address, so that a new sink
+        // at the address of a destroyed one never sees a stale ring
+        thread_local std::vector<std::pair<std::uint64_t, log_ring *>> cache;
+        for (auto const & [sink_id, ring] : cache) {
+            if (sink_id == id) { return *ring; }
+        }
+
+        std::scoped_lock lock{ rings_mutex };
+        auto & ring = rings.emplace_back(
+                std::make_unique<log_ring>(ring_capacity));
+        cache.emplace_back(id, ring.get());
+        return *ring;
+    }
+
+    void run()
+    {
+        std::vector<log_ring *> snapshot;
+        std::string batch;
+        bool stopping = false;
+        while (not stopping) {
+            stopping = not running.load(std::memory_order_acquire);
+            {
+                std::scoped_lock lock{ rings_mutex };
+                snapshot.clear();
+                for (auto const & ring : rings) {
+                    snapshot.push_back(ring.get());
+                }
+            }
+
+            std::size_t count = 0;
+            batch.clear();
+            {
+                std::scoped_lock lock{ formats_mutex };
+                log_record record;
+                for (log_ring * ring : snapshot) {
+                    while (ring->try_pop(record)) {
+                        format_record(record, batch);
+                        ++count;
+                    }
+                }
+            }
+            if (count > 0) {
+                output << batch;
+                output.flush();
+                written.fetch_add(count, std::memory_order_release);
+            }
+            else if (not stopping) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+            }
+        }
+    }
+
+    void format_record(log_record const & record, std::string & line) const
+    {
+        if (record.format >= formats.size()) {
+            line += "<unregistered log format>\n";
+            return;
+        }
+
+        std::string_view pattern = formats[record.format];
+        std::size_t offset = 0;
+        for (std::uint8_t i = 0; i < record.count; ++i) {
+            auto const placeholder = pattern.find("{}");
+            if (placeholder == std::string_view::npos) { break; }
+            line.append(pattern.substr(0, placeholder));
+            pattern.remove_prefix(placeholder + 2);
+            offset = append_argument(record, offset, line);
+        }
+        line.append(pattern);
+        line += '\n';
+    }
+
+    static std::size_t append_argument(log_record const & record,
+                                       std::size_t offset,
+                                       std::string & line)
+    {
+        using tag = log_record::tag;
+        char const * data = record.payload.data() + offset;
+        auto const type = static_cast<tag>(*data++);
+
+        if (type == tag::string) {
+            auto const length = static_cast<unsigned char>(*data++);
+            line.append(data, length);
+            return offset + 2 + length;
+        }
+
+        std::array<char, 32> digits;
+        std::to_chars_result result;
+        if (type == tag::signed_integer) {
+            std::int64_t value;
+            std::memcpy(&value, data, sizeof(value));
+            result = std::to_chars(digits.data(),
+                                   digits.data() + digits.size(), value);
+        }
+        else if (type == tag::unsigned_integer) {
+            std::uint64_t value;
+            std::memcpy(&value, data, sizeof(value));
+            result = std::to_chars(digits.data(),
+                                   digits.data() + digits.size(), value);
+        }
+        else if (type == tag::floating_point) {
+            double value;
+            std::memcpy(&value, data, sizeof(value));
+            result = std::to_chars(digits.data(),
+                                   digits.data() + digits.size(), value);
+        }
+        else {
+            line += (*data != 0) ? "true" : "false";
+            return offset + 1 + sizeof(std::uint8_t);
+        }
+        line.append(digits.data(), result.ptr);
+        return offset + 1 + 8;
+    }
+};
+
+inline log_name_output &
+log_name_output::operator=(std::string_view name)
+{
+    if (sink) { sink->write(format, name); }
+    return *this;
+}
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include "raisin/future.hpp"
+
+// data types
+#include <string>
+#include <cstddef>
+
+// data structures
+#include <span>
+#include <vector>
+#include <utility>
+
+// i/o
+#include <filesystem>
+#include <fstream>
+
+#if __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace raisin {
+
+using namespace std::string_literals;
+
+/**
+ * \brief A read-only file mapped into memory
+ *
+ * The file is mapped with mmap where it's available, so its pages are read
+ * from the page cache as they're touched rather than copied. Elsewhere the
+ * file is read into memory.
+ */
+class mapped_file {
+public:
+    /**
+     * \brief Map a file into memory
+     *
+     * \param path  the path to the file
+     *
+     * \return the mapped file, or a descriptive message if it couldn't be
+     *         mapped
+     */
+    static expected<mapped_file, std::string> open(std::string const & path)
+    {
+        if (not std::filesystem::exists(path)) {
+            std::string const description =
+                "Expecting a file at "s + path + ", but it doesn't exist"s;
+            return unexpected{ description };
+        }
+
+        mapped_file file;
+#if __has_include(<sys/mman.h>)
+        int const descriptor = ::open(path.c_str(), O_RDONLY);
+        struct stat status;
+        if (descriptor < 0 or ::fstat(descriptor, &status) != 0) {
+            if (descriptor >= 0) { ::close(descriptor); }
+            return unexpected{ "Couldn't open "s + path };
+        }
+        file.size = static_cast<std::size_t>(status.st_size);
+        if (file.size > 0) {
+            void * address = ::mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE,
+                                    descriptor, 0);
+            if (address == MAP_FAILED) {
+                ::close(descriptor);
+                return unexpected{ "Couldn't map "s + path + " into memory"s };
+            }
+            ::madvise(address, file.size, MADV_WILLNEED);
+            file.address = static_cast<std::byte const *>(address);
+        }
+        // the mapping stays valid after the descriptor is closed
+        ::close(descriptor);
+#else
+        std::ifstream stream{ path, std::ios::binary };
+        file.contents.resize(std::filesystem::file_size(path));
+        if (not stream.read(reinterpret_cast<char *>(file.contents.data()),
+                            static_cast<std::streamsize>(file.contents.size()))) {
+            return unexpected{ "Couldn't read "s + path };
+        }
+        file.address = file.contents.data();
+        file.size = file.contents.size();
+#endif
+        return file;
+    }
+
+    mapped_file(mapped_file && other) noexcept
+        : address{ std::exchange(other.address, nullptr) },
+          size{ std::exchange(other.size, 0) },
+          contents{ std::move(other.contents) }
+    {
+    }
+
+    mapped_file & operator=(mapped_file && other) noexcept
+    {
+        if (this != &other) {
+            unmap();
+            address = std::exchange(other.address, nullptr);
+            size = std::exchange(other.size, 0);
+            contents = std::move(other.contents);
+        }
+        return *this;
+    }
+
+    mapped_file(mapped_file const &) = delete;
+    mapped_file & operator=(mapped_file const &) = delete;
+
+    ~mapped_file() { unmap(); }
+
+    /**
+     * \brief The contents of the file
+     */
+    std::span<std::byte const> bytes() const { return { address, size }; }
+
+private:
+    std::byte const * address = nullptr;
+    std::size_t size = 0;
+
+    // the contents of the file where it can't be mapped
+    std::vector<std::byte> contents;
+
+    mapped_file() = default;
+
+    void unmap()
+    {
+#if __has_include(<sys/mman.h>)
+        if (address) {
+            ::munmap(const_cast<std::byte *>(address), size);
+        }
+#endif
+        address = nullptr;
+        size = 0;
+    }
+};
+}
@@ -0,0 +1,719 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+#include "raisin/sections.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <limits>
+#include <cmath>
+#include <bit>
+
+// data structures
+#include <vector>
+#include <optional>
+#include <unordered_set>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin {
+
+using namespace std::string_literals;
+
+/**
+ * \brief Which parser to parse a document with
+ */
+enum class parse_backend {
+    // toml++, which handles everything in the toml spec
+    toml,
+
+    // raisin's own parser, which is faster for data-heavy documents and
+    // falls back to toml++ for anything it doesn't handle
+    native
+};
+
+inline std::uint64_t constexpr _high_bits = 0x8080808080808080ull;
+inline std::uint64_t constexpr _low_bits = 0x7f7f7f7f7f7f7f7full;
+
+inline std::uint64_t constexpr _broadcast(char ch)
+{
+    return 0x0101010101010101ull * static_cast<unsigned char>(ch);
+}
+
+/**
+ * \brief Set the high bit of each byte of a word that is zero, and no others
+ */
+inline std::uint64_t constexpr _zero_bytes(std::uint64_t word)
+{
+    return ~(((word & _low_bits) + _low_bits) | word | _low_bits);
+}
+
+/**
+ * \brief Check that a document is valid UTF-8
+ *
+ * ASCII text is checked a word at a time.
+ */
+inline bool _valid_utf8(std::string_view text)
+{
+    auto const * data = reinterpret_cast<unsigned char const *>(text.data());
+    std::size_t const size = text.size();
+    std::size_t i = 0;
+    while (i < size) {
+        if (i + 8 <= size) {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            if ((word & _high_bits) == 0) { i += 8; continue; }
+        }
+        unsigned char const lead = data[i];
+        if (lead < 0x80) { ++i; continue; }
+
+        std::size_t length;
+        std::uint32_t code_point;
+        if ((lead & 0xe0) == 0xc0) { length = 2; code_point = lead & 0x1f; }
+        else if ((lead & 0xf0) == 0xe0) { length = 3; code_point = lead & 0x0f; }
+        else if ((lead & 0xf8) == 0xf0) { length = 4; code_point = lead & 0x07; }
+        else { return false; }
+        if (i + length > size) { return false; }
+
+        for (std::size_t j = 1; j < length; ++j) {
+            if ((data[i + j] & 0xc0) != 0x80) { return false; }
+            code_point = (code_point << 6) | (data[i + j] & 0x3f);
+        }
+        std::uint32_t const shortest = length == 2 ? 0x80 :
+                                       length == 3 ? 0x800 : 0x10000;
+        if (code_point < shortest or code_point > 0x10ffff or
+            (code_point >= 0xd800 and code_point <= 0xdfff)) {
+            return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+inline bool _is_digit(char ch) { return ch >= '0' and ch <= '9'; }
+
+/**
+ * \brief Scan digits that may be separated by single underscores
+ *
+ * \return the offset past the digits, or npos if they're malformed
+ */
+inline std::size_t _scan_digits(std::string_view token, std::size_t i)
+{
+    if (i >= token.size() or not _is_digit(token[i])) {
+        return std::string_view::npos;
+    }
+    for (++i; i < token.size(); ++i) {
+        if (token[i] == '_') {
+            if (i + 1 >= token.size() or not _is_digit(token[i + 1])) {
+                return std::string_view::npos;
+            }
+        }
+        else if (not _is_digit(token[i])) {
+            break;
+        }
+    }
+    return i;
+}
+
+/**
+ * \brief A single-pass toml parser for the common subset of toml
+ *
+ * The parser handles tables, arrays of tables, dotted and quoted keys, basic
+ * and literal strings, decimal, hexadecimal, octal and binary integers,
+ * floats, booleans, arrays and inline tables. Anything else, and anything
+ * malformed, stops the parse so that toml++ can parse the document instead.
+ */
+class _native_parser {
+public:
+    explicit _native_parser(std::string_view text)
+        : text{ text }
+    {
+    }
+
+    /**
+     * \return the parsed document, or nothing if the document needs toml++
+     */
+    std::optional<toml::table> parse()
+    {
+        if (text.starts_with("\xef\xbb\xbf")) { position = 3; }
+        if (not _valid_utf8(text)) { return std::nullopt; }
+
+        while (true) {
+            skip_blank_lines();
+            if (position >= text.size()) { break; }
+
+            bool const parsed = text[position] == '[' ?
+                parse_header() : parse_key_value(*current);
+            if (not parsed or not end_of_line()) { return std::nullopt; }
+        }
+        return std::move(root);
+    }
+
+private:
+    struct array_sink {
+        toml::array & array;
+
+        template<typename value_t>
+        void operator()(value_t && value)
+        {
+            array.push_back(std::forward<value_t>(value));
+        }
+    };
+
+    struct table_sink {
+        toml::table & table;
+        std::string_view key;
+
+        template<typename value_t>
+        void operator()(value_t && value)
+        {
+            table.insert(key, std::forward<value_t>(value));
+        }
+    };
+
+    std::string_view text;
+    std::size_t position = 0;
+
+    toml::table root;
+    toml::table * current = &root;
+    std::vector<std::string_view> keys;
+
+    // tables defined by a header, tables defined by dotted keys, and arrays
+    // defined by [[array]] headers, which can't be redefined
+    std::unordered_set<toml::node const *> defined;
+    std::unordered_set<toml::node const *> dotted;
+    std::unordered_set<toml::node const *> table_arrays;
+
+    bool at(char ch) const
+    {
+        return position < text.size() and text[position] == ch;
+    }
+
+    void skip_whitespace()
+    {
+        if constexpr (std::endian::native == std::endian::little) {
+            while (position + 8 <= text.size()) {
+                std::uint64_t word;
+                std::memcpy(&word, text.data() + position, sizeof(word));
+                std::uint64_t const blank = _zero_bytes(word ^ _broadcast(' ')) |
+                                            _zero_bytes(word ^ _broadcast('\t'));
+                std::uint64_t const other = ~blank & _high_bits;
+                if (other) {
+                    position += std::countr_zero(other) / 8;
+                    return;
+                }
+                position += 8;
+            }
+        }
+        while (at(' ') or at('\t')) { ++position; }
+    }
+
+    void skip_comment()
+    {
+        if (not at('#')) { return; }
+        std::size_t const newline = text.find('\n', position);
+        position = newline == std::string_view::npos ? text.size() : newline;
+    }
+
+    bool skip_newline()
+    {
+        if (at('\n')) { ++position; return true; }
+        if (text.substr(position, 2) == "\r\n") { position += 2; return true; }
+        return false;
+    }
+
+    void skip_blank_lines()
+    {
+        do {
+            skip_whitespace();
+            skip_comment();
+        } while (skip_newline());
+    }
+
+    bool end_of_line()
+    {
+        skip_whitespace();
+        skip_comment();
+        return position >= text.size() or skip_newline();
+    }
+
+    std::optional<std::string_view> parse_simple_key()
+    {
+        if (position >= text.size()) { return std::nullopt; }
+
+        char const quote = text[position];
+        if (quote == '"' or quote == '\'') {
+            // quoted keys with escape sequences are left to toml++
+            std::size_t i = position + 1;
+            while (i < text.size() and text[i] != quote) {
+                if (text[i] == '\n' or text[i] == '\\') { return std::nullopt; }
+                ++i;
+            }
+            if (i >= text.size()) { return std::nullopt; }
+            std::string_view const key = text.substr(position + 1,
+                                                     i - position - 1);
+            position = i + 1;
+            return key;
+        }
+
+        std::size_t const begin = position;
+        while (position < text.size() and _is_bare_key_char(text[position])) {
+            ++position;
+        }
+        if (position == begin) { return std::nullopt; }
+        return text.substr(begin, position - begin);
+    }
+
+    bool parse_key()
+    {
+        keys.clear();
+        while (true) {
+            skip_whitespace();
+            auto const key = parse_simple_key();
+            if (not key) { return false; }
+            keys.push_back(*key);
+
+            skip_whitespace();
+            if (not at('.')) { return true; }
+            ++position;
+        }
+    }
+
+    toml::table * header_table(toml::table & parent, std::string_view key)
+    {
+        toml::node * existing = parent.get(key);
+        if (not existing) {
+            parent.insert(key, toml::table{});
+            return parent.get(key)->as_table();
+        }
+        if (auto * table = existing->as_table()) {
+            return table->is_inline() ? nullptr : table;
+        }
+        auto * array = existing->as_array();
+        if (array and table_arrays.contains(array)) {
+            return (*array)[array->size() - 1].as_table();
+        }
+        return nullptr;
+    }
+
+    bool parse_header()
+    {
+        bool const is_array_of_tables = text.substr(position, 2) == "[[";
+        position += is_array_of_tables ? 2 : 1;
+        if (not parse_key()) { return false; }
+
+        std::string_view const close = is_array_of_tables ? "]]" : "]";
+        if (text.substr(position, close.size()) != close) { return false; }
+        position += close.size();
+
+        toml::table * table = &root;
+        for (std::size_t i = 0; i + 1 < keys.size(); ++i) {
+            table = header_table(*table, keys[i]);
+            if (not table) { return false; }
+        }
+
+        std::string_view const key = keys.back();
+        toml::node * existing = table->get(key);
+        if (is_array_of_tables) {
+            toml::array * array;
+            if (not existing) {
+                table->insert(key, toml::array{});
+                array = table->get(key)->as_array();
+                table_arrays.insert(array);
+            }
+            else {
+                array = existing->as_array();
+                if (not array or not table_arrays.contains(array)) {
+                    return false;
+                }
+            }
+            array->push_back(toml::table{});
+            current = (*array)[array->size() - 1].as_table();
+            return true;
+        }
+
+        if (not existing) {
+            table->insert(key, toml::table{});
+            current = table->get(key)->as_table();
+        }
+        else {
+            current = existing->as_table();
+            if (not current or current->is_inline() or
+                defined.contains(current) or dotted.contains(current)) {
+                return false;
+            }
+        }
+        defined.insert(current);
+        return true;
+    }
+
+    bool parse_key_value(toml::table & target)
+    {
+        if (not parse_key() or not at('=')) { return false; }
+        ++position;
+        skip_whitespace();
+
+        toml::table * table = &target;
+        for (std::size_t i = 0; i + 1 < keys.size(); ++i) {
+            toml::node * existing = table->get(keys[i]);
+            if (not existing) {
+                table->insert(keys[i], toml::table{});
+                table = table->get(keys[i])->as_table();
+                dotted.insert(table);
+                continue;
+            }
+            table = existing->as_table();
+            if (not table or table->is_inline() or not dotted.contains(table)) {
+                return false;
+            }
+        }
+
+        std::string_view const key = keys.back();
+        if (table->contains(key)) { return false; }
+        return parse_value(table_sink{ *table, key });
+    }
+
+    template<typename sink_t>
+    bool parse_value(sink_t && insert)
+    {
+        if (position >= text.size()) { return false; }
+
+        switch (text[position]) {
+        case '"': {
+            // multi-line strings are left to toml++
+            if (text.substr(position, 3) == "\"\"\"") { return false; }
+            std::string value;
+            if (not parse_basic_string(value)) { return false; }
+            insert(std::move(value));
+            return true;
+        }
+        case '\'': {
+            if (text.substr(position, 3) == "'''") { return false; }
+            std::size_t const begin = position + 1;
+            std::size_t end = begin;
+            while (end < text.size() and text[end] != '\'') {
+                unsigned char const ch = text[end];
+                if ((ch < 0x20 and ch != '\t') or ch == 0x7f) { return false; }
+                ++end;
+            }
+            if (end >= text.size()) { return false; }
+            insert(std::string{ text.substr(begin, end - begin) });
+            position = end + 1;
+            return true;
+        }
+        case '[': {
+            toml::array array;
+            if (not parse_array(array)) { return false; }
+            insert(std::move(array));
+            return true;
+        }
+        case '{': {
+            toml::table table;
+            if (not parse_inline_table(table)) { return false; }
+            insert(std::move(table));
+            return true;
+        }
+        case 't':
+            if (text.substr(position, 4) != "true") { return false; }
+            position += 4;
+            insert(true);
+            return true;
+        case 'f':
+            if (text.substr(position, 5) != "false") { return false; }
+            position += 5;
+            insert(false);
+            return true;
+        default:
+            return parse_number(insert);
+        }
+    }
+
+    bool parse_basic_string(std::string & value)
+    {
+        ++position;
+        while (true) {
+            std::size_t end = position;
+            while (end < text.size()) {
+                unsigned char const ch = text[end];
+                if (ch == '"' or ch == '\\' or (ch < 0x20 and ch != '\t') or
+                    ch == 0x7f) {
+                    break;
+                }
+                ++end;
+            }
+            value.append(text.substr(position, end - position));
+            position = end;
+
+            if (position >= text.size()) { return false; }
+            if (text[position] == '"') { ++position; return true; }
+            if (text[position] != '\\' or position + 1 >= text.size()) {
+                return false;
+            }
+
+            char const escape = text[position + 1];
+            position += 2;
+            switch (escape) {
+            case 'b': value += '\b'; break;
+            case 't': value += '\t'; break;
+            case 'n': value += '\n'; break;
+            case 'f': value += '\f'; break;
+            case 'r': value += '\r'; break;
+            case '"': value += '"'; break;
+            case '\\': value += '\\'; break;
+            case 'u':
+            case 'U':
+                if (not parse_unicode_escape(value, escape == 'u' ? 4 : 8)) {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+            }
+        }
+    }
+
+    bool parse_unicode_escape(std::string & value, std::size_t digits)
+    {
+        std::string_view const hex = text.substr(position, digits);
+        std::uint32_t code_point = 0;
+        auto const [end, error] = std::from_chars(
+                hex.data(), hex.data() + hex.size(), code_point, 16);
+        if (hex.size() != digits or error != std::errc{} or
+            end != hex.data() + hex.size() or code_point > 0x10ffff or
+            (code_point >= 0xd800 and code_point <= 0xdfff)) {
+            return false;
+        }
+        position += digits;
+
+        if (code_point < 0x80) {
+            value += static_cast<char>(code_point);
+        }
+        else if (code_point < 0x800) {
+            value += static_cast<char>(0xc0 | (code_point >> 6));
+            value += static_cast<char>(0x80 | (code_point & 0x3f));
+        }
+        else if (code_point < 0x10000) {
+            value += static_cast<char>(0xe0 | (code_point >> 12));
+            value += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+            value += static_cast<char>(0x80 | (code_point & 0x3f));
+        }
+        else {
+            value += static_cast<char>(0xf0 | (code_point >> 18));
+            value += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+            value += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+            value += static_cast<char>(0x80 | (code_point & 0x3f));
+        }
+        return true;
+    }
+
+    /**
+     * \brief Count the elements of an array of plain values ahead of time
+     *
+     * \return an upper bound on the number of elements, or 0 if the array
+     *         holds strings, arrays or tables, or has comments
+     */
+    std::size_t count_elements() const
+    {
+        std::size_t commas = 0;
+        for (std::size_t i = position; i < text.size(); ++i) {
+            switch (text[i]) {
+            case ',': ++commas; break;
+            case ']': return commas + 1;
+            case '[': case '{': case '"': case '\'': case '#': return 0;
+            default: break;
+            }
+        }
+        return 0;
+    }
+
+    bool parse_array(toml::array & array)
+    {
+        ++position;
+        array.reserve(count_elements());
+        while (true) {
+            skip_blank_lines();
+            if (at(']')) { ++position; return true; }
+            if (not parse_value(array_sink{ array })) { return false; }
+
+            skip_blank_lines();
+            if (at(',')) { ++position; continue; }
+            if (at(']')) { ++position; return true; }
+            return false;
+        }
+    }
+
+    bool parse_inline_table(toml::table & table)
+    {
+        ++position;
+        skip_whitespace();
+        if (not at('}')) {
+            while (true) {
+                if (not parse_key_value(table)) { return false; }
+                skip_whitespace();
+                if (at(',')) { ++position; continue; }
+                if (at('}')) { break; }
+                return false;
+            }
+        }
+        ++position;
+        table.is_inline(true);
+        return true;
+    }
+
+    template<typename sink_t>
+    bool parse_number(sink_t & insert)
+    {
+        std::size_t const begin = position;
+        while (position < text.size()) {
+            char const ch = text[position];
+            if (not _is_bare_key_char(ch) and ch != '+' and ch != '.' and
+                ch != ':') {
+                break;
+            }
+            ++position;
+        }
+        std::string_view const token = text.substr(begin, position - begin);
+        if (token.empty()) { return false; }
+
+        // dates and times are left to toml++
+        if (token.find(':') != std::string_view::npos) { return false; }
+        for (std::size_t i = 1; i < token.size(); ++i) {
+            if (token[i] == '-' and _is_digit(token[i - 1])) { return false; }
+        }
+
+        bool const has_sign = token[0] == '+' or token[0] == '-';
+        bool const negative = token[0] == '-';
+        std::string_view const body = token.substr(has_sign ? 1 : 0);
+
+        if (body == "inf" or body == "nan") {
+            double const value = body == "inf" ?
+                std::numeric_limits<double>::infinity() :
+                std::numeric_limits<double>::quiet_NaN();
+            insert(negative ? -value : value);
+            return true;
+        }
+
+        if (body.size() > 2 and body[0] == '0' and
+            (body[1] == 'x' or body[1] == 'o' or body[1] == 'b')) {
+            if (has_sign) { return false; }
+            int const base = body[1] == 'x' ? 16 : body[1] == 'o' ? 8 : 2;
+            return parse_integer(insert, body.substr(2), base);
+        }
+
+        // validate the number's grammar, which from_chars is laxer about
+        std::size_t i = _scan_digits(body, 0);
+        if (i == std::string_view::npos) { return false; }
+        if (body[0] == '0' and i > 1) { return false; }
+        bool is_float = false;
+        if (i < body.size() and body[i] == '.') {
+            is_float = true;
+            i = _scan_digits(body, i + 1);
+            if (i == std::string_view::npos) { return false; }
+        }
+        if (i < body.size() and (body[i] == 'e' or body[i] == 'E')) {
+            is_float = true;
+            ++i;
+            if (i < body.size() and (body[i] == '+' or body[i] == '-')) { ++i; }
+            i = _scan_digits(body, i);
+            if (i == std::string_view::npos) { return false; }
+        }
+        if (i != body.size()) { return false; }
+
+        // from_chars takes a leading minus sign, but not a plus sign
+        std::string_view const number = negative ? token : body;
+        if (not is_float) { return parse_integer(insert, number, 10); }
+
+        std::string digits;
+        digits.reserve(number.size());
+        for (char ch : number) {
+            if (ch != '_') { digits += ch; }
+        }
+        double value;
+        auto const [end, error] = std::from_chars(
+                digits.data(), digits.data() + digits.size(), value);
+        if (error != std::errc{} or end != digits.data() + digits.size()) {
+            return false;
+        }
+        insert(value);
+        return true;
+    }
+
+    template<typename sink_t>
+    bool parse_integer(sink_t & insert, std::string_view token, int base)
+    {
+        char digits[80];
+        std::size_t size = 0;
+        for (char ch : token) {
+            if (ch == '_') { continue; }
+            if (size == sizeof(digits)) { return false; }
+            digits[size++] = ch;
+        }
+
+        std::int64_t value;
+        auto const [end, error] = std::from_chars(digits, digits + size,
+                                                  value, base);
+        if (size == 0 or error != std::errc{} or end != digits + size) {
+            return false;
+        }
+        insert(value);
+        return true;
+    }
+};
+
+/**
+ * \brief Parse a toml document with raisin's native parser
+ *
+ * The native parser is a single pass over the document that skips whitespace
+ * a word at a time, parses numbers with std::from_chars and reserves numeric
+ * arrays up front, which makes it much faster than toml++ for data-heavy
+ * documents. It builds the same toml::table, so every loader works with it.
+ *
+ * \param document      the text of the document
+ * \param source_path   the path of the document, for error messages
+ *
+ * \return the parsed table, or a descriptive error message
+ *
+ * \note Documents with dates, times or multi-line strings, and documents that
+ *       are malformed, are parsed by toml++ instead, so the result and any
+ *       error messages are the same as parsing with toml++.
+ */
+inline expected<toml::table, std::string>
+parse_native(std::string_view document, std::string const & source_path = ""s)
+{
+    if (auto table = _native_parser{ document }.parse()) {
+        return std::move(*table);
+    }
+
+    toml::parse_result result = toml::parse(document, source_path);
+    if (not result) {
+        std::string const description{ result.error().description() };
+        return unexpected{ description };
+    }
+    return std::move(result).table();
+}
+
+/**
+ * \brief Parse a toml file with a particular parser
+ *
+ * \param config_path   the path to the config file.
+ * \param backend       the parser to parse the file with
+ *
+ * \return The parsed toml table if parsing was successful, otherwise the
+ *         error message for why parsing failed.
+ */
+inline expected<toml::table, std::string>
+parse_file(std::string const & config_path, parse_backend backend)
+{
+    if (backend == parse_backend::toml) { return parse_file(config_path); }
+
+    auto text = read_text_file(config_path);
+    if (not text) { return unexpected(text.error()); }
+    return parse_native(*text, config_path);
+}
+}
@@ -0,0 +1,473 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+#include "raisin/sidecar.hpp"
+#include "raisin/vec.hpp"
+
+// data types
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <limits>
+
+// data structures
+#include <span>
+#include <array>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+
+// algorithms
+#include <algorithm>
+
+// concurrency
+#include <future>
+#include <thread>
+
+// i/o
+#include <filesystem>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+inline namespace raisin {
+
+using namespace std::string_literals;
+
+namespace limits {
+// the cost of a grid cell that can't be walked through
+std::uint8_t constexpr impassable_cost = 255;
+
+// grids with fewer cells than this find their flow directions on one thread
+std::size_t constexpr min_parallel_flow_cells = 64 * 1024;
+}
+
+/**
+ * \brief A cell of a grid
+ */
+struct grid_cell {
+    std::int32_t x = 0;
+    std::int32_t y = 0;
+
+    friend bool operator==(grid_cell const &, grid_cell const &) = default;
+};
+
+/**
+ * \brief The cost of walking through each cell of a level
+ *
+ * Costs go from 1, for open ground, to 254; cells that cost
+ * limits::impassable_cost are walls.
+ */
+class cost_grid {
+public:
+    cost_grid() = default;
+
+    cost_grid(std::int32_t width, std::int32_t height, float cell_size = 1.0f)
+        : grid_width{ width }, grid_height{ height }, size_of_cell{ cell_size },
+          costs(static_cast<std::size_t>(width) * height, 1)
+    {
+    }
+
+    std::int32_t width() const { return grid_width; }
+    std::int32_t height() const { return grid_height; }
+
+    /**
+     * \brief The size of a cell in world units
+     */
+    float cell_size() const { return size_of_cell; }
+
+    bool contains(grid_cell cell) const
+    {
+        return cell.x >= 0 and cell.y >= 0 and
+               cell.x < grid_width and cell.y < grid_height;
+    }
+
+    std::size_t index(grid_cell cell) const
+    {
+        return static_cast<std::size_t>(cell.y) * grid_width + cell.x;
+    }
+
+    /**
+     * \brief The cell a world position is in
+     */
+    grid_cell cell_at(vec2f position) const
+    {
+        return { static_cast<std::int32_t>(std::floor(position.x / size_of_cell)),
+                 static_cast<std::int32_t>(std::floor(position.y / size_of_cell)) };
+    }
+
+    std::uint8_t cost(grid_cell cell) const { return costs[index(cell)]; }
+    void set_cost(grid_cell cell, std::uint8_t cost) { costs[index(cell)] = cost; }
+
+    bool passable(grid_cell cell) const
+    {
+        return contains(cell) and cost(cell) != limits::impassable_cost;
+    }
+
+    /**
+     * \brief Every cell's cost, row by row
+     */
+    std::span<std::uint8_t const> values() const { return costs; }
+    std::span<std::uint8_t> values() { return costs; }
+
+private:
+    std::int32_t grid_width = 0;
+    std::int32_t grid_height = 0;
+    float size_of_cell = 1.0f;
+    std::vector<std::uint8_t> costs;
+};
+
+inline std::optional<std::string>
+_add_cost_layer(toml::table const & layers, std::string const & key,
+                std::string const & path,
+                std::filesystem::path const & directory, cost_grid & grid)
+{
+    std::size_t const cell_count = grid.values().size();
+    std::vector<std::int64_t> layer;
+    layer.reserve(cell_count);
+
+    toml::node const * node = layers.get(key);
+    if (auto const * array = node->as_array()) {
+        // either every cell in one array, or one array per row
+        for (toml::node const & element : *array) {
+            if (auto const * row = element.as_array()) {
+                if (row->size() != static_cast<std::size_t>(grid.width())) {
+                    return path + " must have rows of "s +
+                           std::to_string(grid.width()) + " cells"s;
+                }
+                for (toml::node const & cell : *row) {
+                    layer.push_back(cell.value_or(std::int64_t{ -1 }));
+                }
+            }
+            else {
+                layer.push_back(element.value_or(std::int64_t{ -1 }));
+            }
+        }
+    }
+    else {
+        auto sidecar = load_sidecar<std::uint8_t>(layers, key, directory);
+        if (not sidecar) { return sidecar.error(); }
+        layer.assign(sidecar->begin(), sidecar->end());
+    }
+
+    if (layer.size() != cell_count) {
+        return path + " must have "s + std::to_string(cell_count) +
+               " cells, but it has "s + std::to_string(layer.size());
+    }
+
+    std::span<std::uint8_t> const costs = grid.values();
+    for (std::size_t i = 0; i < cell_count; ++i) {
+        if (layer[i] < 0 or layer[i] > limits::impassable_cost) {
+            return path + " must have costs from 0 to "s +
+                   std::to_string(limits::impassable_cost);
+        }
+        std::int64_t const sum = costs[i] == limits::impassable_cost ?
+            limits::impassable_cost : costs[i] + layer[i];
+        costs[i] = static_cast<std::uint8_t>(
+                std::min<std::int64_t>(sum, limits::impassable_cost));
+    }
+    return std::nullopt;
+}
+
+/**
+ * \brief Load the cost grid of a level from its layers
+ *
+ * Every layer adds its cost to each cell, on top of a base cost of 1, and a
+ * cell is a wall if any layer makes it cost limits::impassable_cost or more.
+ * A layer is an array of every cell, an array of rows, or a sidecar of u8
+ * costs:
+ *
+ *      [level.navigation]
+ *      width = 256
+ *      height = 256
+ *      cell-size = 16.0
+ *
+ *      [level.navigation.layers]
+ *      terrain = { sidecar = "level.terrain.bin", type = "u8", shape = [256, 256] }
+ *      buildings = [[0, 0, 255, ...], ...]
+ *
+ * \param table             the table with the grid
+ * \param variable_path     the toml path to the grid
+ * \param directory         the directory sidecar paths are relative to
+ *
+ * \return the grid, or a descriptive error message
+ */
+inline expected<cost_grid, std::string>
+load_cost_grid(toml::table const & table, std::string const & variable_path,
+               std::filesystem::path const & directory = {})
+{
+    auto const navigation = subtable_view(table, variable_path);
+    if (not navigation) { return unexpected(navigation.error()); }
+
+    auto const width = (**navigation)["width"].value<std::int32_t>();
+    auto const height = (**navigation)["height"].value<std::int32_t>();
+    if (not width or not height or *width <= 0 or *height <= 0) {
+        return unexpected{ variable_path + " must have a positive width "s
+                           "and height"s };
+    }
+    float const cell_size = (**navigation)["cell-size"].value_or(1.0f);
+    cost_grid grid{ *width, *height, cell_size };
+
+    if (auto const * layers = (**navigation)["layers"].as_table()) {
+        for (auto && [key, layer] : *layers) {
+            std::string const path =
+                variable_path + ".layers."s + key.str();
+            auto error = _add_cost_layer(*layers, key.str(), path,
+                                         directory, grid);
+            if (error) { return unexpected{ *error }; }
+        }
+    }
+    return grid;
+}
+
+/**
+ * \brief The direction to walk from every cell of a grid to reach a goal
+ *
+ * A flow field is computed once per goal, and any number of units can then
+ * sample it in constant time, so pathfinding costs grow with goals rather
+ * than with units.
+ */
+class flow_field {
+public:
+    // the direction of the goal cells, and of cells that can't reach a goal
+    static std::uint8_t constexpr at_goal = 8;
+    static std::uint8_t constexpr unreachable = 9;
+    static std::uint32_t constexpr unreachable_distance =
+        std::numeric_limits<std::uint32_t>::max();
+
+    /**
+     * \brief Compute the flow field to the nearest of some goals
+     *
+     * Distances are integrated from the goals with Dijkstra's algorithm over
+     * a bucket queue (Dial's algorithm), since costs are small integers, in
+     * row-major order over the grid. Then each cell's direction is the
+     * neighbour closest to a goal, which is found in parallel by bands of
+     * rows.
+     *
+     * \param grid      the cost of each cell
+     * \param goals     the cells to walk to
+     * \param threads   the most threads to find directions with
+     */
+    flow_field(cost_grid const & grid, std::span<grid_cell const> goals,
+               std::size_t threads = std::thread::hardware_concurrency())
+        : width{ grid.width() }, height{ grid.height() },
+          cell_size{ grid.cell_size() },
+          distances(grid.values().size(), unreachable_distance),
+          directions(grid.values().size(), unreachable)
+    {
+        integrate(grid, goals);
+
+        std::size_t const cells = distances.size();
+        if (threads <= 1 or cells < limits::min_parallel_flow_cells) {
+            find_directions(grid, 0, height);
+            return;
+        }
+
+        std::int32_t const bands = static_cast<std::int32_t>(
+                std::min<std::size_t>(threads, height));
+        std::vector<std::future<void>> finding;
+        for (std::int32_t band = 0; band < bands; ++band) {
+            std::int32_t const first = height * band / bands;
+            std::int32_t const last = height * (band + 1) / bands;
+            finding.push_back(std::async(std::launch::async,
+                [this, &grid, first, last] {
+                    find_directions(grid, first, last);
+                }));
+        }
+        for (auto & band : finding) { band.get(); }
+    }
+
+    flow_field(cost_grid const & grid, grid_cell goal,
+               std::size_t threads = std::thread::hardware_concurrency())
+        : flow_field{ grid, std::span<grid_cell const>{ &goal, 1 }, threads }
+    {
+    }
+
+    /**
+     * \brief The direction to walk from a cell, one of the eight neighbours,
+     *        at_goal or unreachable
+     */
+    std::uint8_t direction(grid_cell cell) const
+    {
+        if (cell.x < 0 or cell.y < 0 or cell.x >= width or cell.y >= height) {
+            return unreachable;
+        }
+        return directions[static_cast<std::size_t>(cell.y) * width + cell.x];
+    }
+
+    /**
+     * \brief The total cost of walking from a cell to the nearest goal
+     */
+    std::uint32_t distance(grid_cell cell) const
+    {
+        if (cell.x < 0 or cell.y < 0 or cell.x >= width or cell.y >= height) {
+            return unreachable_distance;
+        }
+        return distances[static_cast<std::size_t>(cell.y) * width + cell.x];
+    }
+
+    /**
+     * \brief The unit direction to walk from a world position, or zero at a
+     *        goal or where no goal can be reached
+     */
+    vec2f sample(vec2f position) const
+    {
+        grid_cell const cell{
+            static_cast<std::int32_t>(std::floor(position.x / cell_size)),
+            static_cast<std::int32_t>(std::floor(position.y / cell_size)) };
+        return unit_vectors[direction(cell)];
+    }
+
+    /**
+     * \brief Every cell's direction, row by row
+     */
+    std::span<std::uint8_t const> values() const { return directions; }
+
+private:
+    static constexpr std::array<grid_cell, 8> offsets{ {
+        { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 },
+        { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 } } };
+
+    static constexpr float diagonal = 0.70710678f;
+    static constexpr std::array<vec2f, 10> unit_vectors{ {
+        { 1, 0 }, { diagonal, diagonal }, { 0, 1 }, { -diagonal, diagonal },
+        { -1, 0 }, { -diagonal, -diagonal }, { 0, -1 }, { diagonal, -diagonal },
+        { 0, 0 }, { 0, 0 } } };
+
+    std::int32_t width;
+    std::int32_t height;
+    float cell_size;
+    std::vector<std::uint32_t> distances;
+    std::vector<std::uint8_t> directions;
+
+    void integrate(cost_grid const & grid, std::span<grid_cell const> goals)
+    {
+        // every cost is below the number of buckets, so a cell is never
+        // queued into the bucket being drained
+        std::array<std::vector<std::uint32_t>, 256> buckets;
+        std::size_t queued = 0;
+        for (grid_cell goal : goals) {
+            if (not grid.passable(goal)) { continue; }
+            std::size_t const index = grid.index(goal);
+            distances[index] = 0;
+            buckets[0].push_back(static_cast<std::uint32_t>(index));
+            ++queued;
+        }
+
+        std::span<std::uint8_t const> const costs = grid.values();
+        for (std::uint32_t distance = 0; queued > 0; ++distance) {
+            auto & bucket = buckets[distance % buckets.size()];
+            for (std::size_t i = 0; i < bucket.size(); ++i) {
+                std::uint32_t const index = bucket[i];
+                if (distances[index] != distance) { continue; }
+
+                std::int32_t const x = index % width;
+                std::int32_t const y = index / width;
+                auto const relax = [&](bool inside, std::uint32_t neighbour) {
+                    if (not inside) { return; }
+                    std::uint8_t const cost = costs[neighbour];
+                    if (cost == limits::impassable_cost) { return; }
+                    std::uint32_t const through = distance + cost;
+                    if (through < distances[neighbour]) {
+                        distances[neighbour] = through;
+                        buckets[through % buckets.size()].push_back(neighbour);
+                        ++queued;
+                    }
+                };
+                relax(x + 1 < width, index + 1);
+                relax(x > 0, index - 1);
+                relax(y + 1 < height, index + width);
+                relax(y > 0, index - width);
+            }
+            queued -= bucket.size();
+            bucket.clear();
+        }
+    }
+
+    void find_directions(cost_grid const & grid, std::int32_t first_row,
+                         std::int32_t last_row)
+    {
+        for (std::int32_t y = first_row; y < last_row; ++y) {
+            for (std::int32_t x = 0; x < width; ++x) {
+                std::size_t const index = static_cast<std::size_t>(y) * width + x;
+                if (distances[index] == 0) {
+                    directions[index] = at_goal;
+                    continue;
+                }
+                if (distances[index] == unreachable_distance) { continue; }
+
+                std::uint32_t best = distances[index];
+                for (std::uint8_t d = 0; d < offsets.size(); ++d) {
+                    grid_cell const neighbour{ x + offsets[d].x,
+                                               y + offsets[d].y };
+                    if (not grid.passable(neighbour)) { continue; }
+
+                    // don't cut the corners of walls
+                    if (offsets[d].x != 0 and offsets[d].y != 0 and
+                        (not grid.passable({ x + offsets[d].x, y }) or
+                         not grid.passable({ x, y + offsets[d].y }))) {
+                        continue;
+                    }
+                    std::uint32_t const through = distances[grid.index(neighbour)];
+                    if (through < best) {
+                        best = through;
+                        directions[index] = d;
+                    }
+                }
+            }
+        }
+    }
+};
+
+/**
+ * \brief The flow fields of every goal units have been sent to
+ *
+ * Fields are computed the first time a goal is asked for, and reused by
+ * every unit sent there after that.
+ *
+ * \note The cache refers to the grid, so the grid must outlive it. Clear the
+ *       cache after changing the grid.
+ */
+class flow_field_cache {
+public:
+    explicit flow_field_cache(cost_grid const & grid)
+        : grid{ grid }
+    {
+    }
+
+    /**
+     * \brief Get the flow field to a goal, computing it if it isn't cached
+     */
+    flow_field const & field(grid_cell goal)
+    {
+        std::size_t const key = grid.contains(goal) ?
+            grid.index(goal) : grid.values().size();
+        auto found = fields.find(key);
+        if (found == fields.end()) {
+            found = fields.emplace(key, flow_field{ grid, goal }).first;
+        }
+        return found->second;
+    }
+
+    /**
+     * \brief Forget one goal's flow field
+     */
+    void erase(grid_cell goal)
+    {
+        if (grid.contains(goal)) { fields.erase(grid.index(goal)); }
+    }
+
+    /**
+     * \brief Forget every flow field
+     */
+    void clear() { fields.clear(); }
+
+    std::size_t size() const { return fields.size(); }
+
+private:
+    cost_grid const & grid;
+    std::unordered_map<std::size_t, flow_field> fields;
+};
+}
@@ -0,0 +1,519 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+#include "raisin/vec.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+// data structures
+#include <span>
+#include <array>
+#include <vector>
+
+// algorithms
+#include <algorithm>
+
+// concurrency
+#include <future>
+#include <thread>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+inline namespace raisin {
+
+using namespace std::string_literals;
+
+namespace limits {
+// grids with fewer cells than this are filled on one thread
+std::size_t constexpr min_parallel_noise_cells = 64 * 1024;
+
+// the most octaves of fractal noise
+std::int32_t constexpr max_noise_octaves = 16;
+}
+
+enum class noise_kind { value, perlin, cellular };
+
+inline constexpr std::array<std::string_view, 3> _noise_kind_names{
+    "value", "perlin", "cellular" };
+
+/**
+ * \brief The settings of some fractal noise
+ *
+ * Each octave samples the noise at lacunarity times the frequency of the last
+ * one and gain times its amplitude, and the octaves are summed and scaled
+ * back to [-1, 1].
+ */
+struct noise_settings {
+    noise_kind kind = noise_kind::perlin;
+    std::uint32_t seed = 0;
+    float frequency = 0.01f;
+    std::int32_t octaves = 1;
+    float lacunarity = 2.0f;
+    float gain = 0.5f;
+};
+
+/**
+ * \brief Hash a lattice point into 32 random bits
+ */
+inline std::uint32_t _noise_hash(std::uint32_t seed, std::int32_t x,
+                                 std::int32_t y, std::int32_t z = 0)
+{
+    std::uint32_t hash = seed + static_cast<std::uint32_t>(x) * 0x8da6b343u +
+                         static_cast<std::uint32_t>(y) * 0xd8163841u +
+                         static_cast<std::uint32_t>(z) * 0xcb1ab31fu;
+    hash ^= hash >> 16;
+    hash *= 0x7feb352du;
+    hash ^= hash >> 15;
+    hash *= 0x846ca68bu;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// a hash as a float in [-1, 1)
+inline float _noise_unit(std::uint32_t hash)
+{
+    return static_cast<float>(hash >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+inline float _noise_fade(float t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+inline float _noise_lerp(float a, float b, float t) { return a + t * (b - a); }
+
+// floor by truncating and correcting, which vectorizes where std::floor doesn't
+inline std::int32_t _noise_floor(float x)
+{
+    auto const truncated = static_cast<std::int32_t>(x);
+    return truncated - (x < static_cast<float>(truncated));
+}
+
+/*
+ * The kernels below have no data-dependent branches, so that loops over rows
+ * of samples can be vectorized by the compiler.
+ */
+
+// the dot product of an offset and one of eight gradients picked by a hash,
+// selected with arithmetic rather than branches
+inline float _gradient(std::uint32_t hash, float x, float y)
+{
+    float const swap = static_cast<float>((hash >> 2) & 1);
+    float const u = x + swap * (y - x);
+    float const v = y + swap * (x - y);
+    float const u_sign = 1.0f - static_cast<float>((hash & 1) << 1);
+    float const v_sign = 2.0f - static_cast<float>((hash & 2) << 1);
+    return u_sign * u + v_sign * v;
+}
+
+// the dot product of an offset and one of twelve cube edge gradients
+inline float _gradient(std::uint32_t hash, float x, float y, float z)
+{
+    std::uint32_t const h = hash & 15;
+    float const u = x + static_cast<float>(h >= 8) * (y - x);
+    float const v = z + static_cast<float>(h < 4) * (y - z) +
+                    static_cast<float>((h == 12) | (h == 14)) * (x - z);
+    float const u_sign = 1.0f - static_cast<float>((h & 1) << 1);
+    float const v_sign = 1.0f - static_cast<float>(h & 2);
+    return u_sign * u + v_sign * v;
+}
+
+inline float _value_noise(float x, float y, std::uint32_t seed)
+{
+    std::int32_t const ix = _noise_floor(x), iy = _noise_floor(y);
+    float const fx = static_cast<float>(ix), fy = static_cast<float>(iy);
+    float const tx = _noise_fade(x - fx), ty = _noise_fade(y - fy);
+    return _noise_lerp(
+        _noise_lerp(_noise_unit(_noise_hash(seed, ix, iy)),
+                    _noise_unit(_noise_hash(seed, ix + 1, iy)), tx),
+        _noise_lerp(_noise_unit(_noise_hash(seed, ix, iy + 1)),
+                    _noise_unit(_noise_hash(seed, ix + 1, iy + 1)), tx), ty);
+}
+
+inline float _value_noise(float x, float y, float z, std::uint32_t seed)
+{
+    std::int32_t const ix = _noise_floor(x), iy = _noise_floor(y);
+    std::int32_t const iz = _noise_floor(z);
+    float const fx = static_cast<float>(ix), fy = static_cast<float>(iy);
+    float const fz = static_cast<float>(iz);
+    float const tx = _noise_fade(x - fx), ty = _noise_fade(y - fy);
+    float const tz = _noise_fade(z - fz);
+    auto const corner = [&](std::int32_t dx, std::int32_t dy, std::int32_t dz) {
+        return _noise_unit(_noise_hash(seed, ix + dx, iy + dy, iz + dz));
+    };
+    return _noise_lerp(
+        _noise_lerp(_noise_lerp(corner(0, 0, 0), corner(1, 0, 0), tx),
+                    _noise_lerp(corner(0, 1, 0), corner(1, 1, 0), tx), ty),
+        _noise_lerp(_noise_lerp(corner(0, 0, 1), corner(1, 0, 1), tx),
+                    _noise_lerp(corner(0, 1, 1), corner(1, 1, 1), tx), ty), tz);
+}
+
+inline float _perlin_noise(float x, float y, std::uint32_t seed)
+{
+    std::int32_t const ix = _noise_floor(x), iy = _noise_floor(y);
+    float const fx = static_cast<float>(ix), fy = static_cast<float>(iy);
+    float const rx = x - fx, ry = y - fy;
+    float const tx = _noise_fade(rx), ty = _noise_fade(ry);
+    // gradients of length up to sqrt(5) give at most 0.5 * sqrt(5) * sqrt(2)
+    return 0.6324555f * _noise_lerp(
+        _noise_lerp(_gradient(_noise_hash(seed, ix, iy), rx, ry),
+                    _gradient(_noise_hash(seed, ix + 1, iy), rx - 1, ry), tx),
+        _noise_lerp(_gradient(_noise_hash(seed, ix, iy + 1), rx, ry - 1),
+                    _gradient(_noise_hash(seed, ix + 1, iy + 1), rx - 1, ry - 1),
+                    tx), ty);
+}
+
+inline float _perlin_noise(float x, float y, float z, std::uint32_t seed)
+{
+    std::int32_t const ix = _noise_floor(x), iy = _noise_floor(y);
+    std::int32_t const iz = _noise_floor(z);
+    float const fx = static_cast<float>(ix), fy = static_cast<float>(iy);
+    float const fz = static_cast<float>(iz);
+    float const rx = x - fx, ry = y - fy, rz = z - fz;
+    float const tx = _noise_fade(rx), ty = _noise_fade(ry), tz = _noise_fade(rz);
+    auto const corner = [&](std::int32_t dx, std::int32_t dy, std::int32_t dz) {
+        return _gradient(_noise_hash(seed, ix + dx, iy + dy, iz + dz),
+                         rx - dx, ry - dy, rz - dz);
+    };
+    return _noise_lerp(
+        _noise_lerp(_noise_lerp(corner(0, 0, 0), corner(1, 0, 0), tx),
+                    _noise_lerp(corner(0, 1, 0), corner(1, 1, 0), tx), ty),
+        _noise_lerp(_noise_lerp(corner(0, 0, 1), corner(1, 0, 1), tx),
+                    _noise_lerp(corner(0, 1, 1), corner(1, 1, 1), tx), ty), tz);
+}
+
+// the distance to the nearest of one random point per lattice cell, mapped
+// from [0, 1] to [-1, 1]
+inline float _cellular_noise(float x, float y, std::uint32_t seed)
+{
+    std::int32_t const ix = _noise_floor(x), iy = _noise_floor(y);
+    float const fx = static_cast<float>(ix), fy = static_cast<float>(iy);
+    float nearest = 2.0f;
+    for (std::int32_t dy = -1; dy <= 1; ++dy) {
+        for (std::int32_t dx = -1; dx <= 1; ++dx) {
+            std::uint32_t const hash = _noise_hash(seed, ix + dx, iy + dy);
+            float const px = dx + (hash & 0xffff) * (1.0f / 65536.0f);
+            float const py = dy + (hash >> 16) * (1.0f / 65536.0f);
+            float const ox = px - (x - fx), oy = py - (y - fy);
+            nearest = std::min(nearest, ox * ox + oy * oy);
+        }
+    }
+    return std::min(std::sqrt(nearest), 1.0f) * 2.0f - 1.0f;
+}
+
+inline float _cellular_noise(float x, float y, float z, std::uint32_t seed)
+{
+    std::int32_t const ix = _noise_floor(x), iy = _noise_floor(y);
+    std::int32_t const iz = _noise_floor(z);
+    float const fx = static_cast<float>(ix), fy = static_cast<float>(iy);
+    float const fz = static_cast<float>(iz);
+    float nearest = 3.0f;
+    for (std::int32_t dz = -1; dz <= 1; ++dz) {
+        for (std::int32_t dy = -1; dy <= 1; ++dy) {
+            for (std::int32_t dx = -1; dx <= 1; ++dx) {
+                std::uint32_t const hash =
+                    _noise_hash(seed, ix + dx, iy + dy, iz + dz);
+                float const px = dx + (hash & 0x3ff) * (1.0f / 1024.0f);
+                float const py = dy + ((hash >> 10) & 0x3ff) * (1.0f / 1024.0f);
+                float const pz = dz + (hash >> 22) * (1.0f / 1024.0f);
+                float const ox = px - (x - fx), oy = py - (y - fy);
+                float const oz = pz - (z - fz);
+                nearest = std::min(nearest, ox * ox + oy * oy + oz * oz);
+            }
+        }
+    }
+    return std::min(std::sqrt(nearest), 1.0f) * 2.0f - 1.0f;
+}
+
+template<noise_kind kind, typename... coordinates_t>
+float _noise_octave(std::uint32_t seed, coordinates_t... coordinates)
+{
+    if constexpr (kind == noise_kind::value) {
+        return _value_noise(coordinates..., seed);
+    }
+    else if constexpr (kind == noise_kind::perlin) {
+        return _perlin_noise(coordinates..., seed);
+    }
+    else {
+        return _cellular_noise(coordinates..., seed);
+    }
+}
+
+template<noise_kind kind, typename... coordinates_t>
+float _fractal_noise(noise_settings const & settings,
+                     coordinates_t... coordinates)
+{
+    float sum = 0.0f;
+    float amplitude = 1.0f;
+    float total_amplitude = 0.0f;
+    float frequency = settings.frequency;
+    for (std::int32_t octave = 0; octave < settings.octaves; ++octave) {
+        sum += amplitude * _noise_octave<kind>(
+            settings.seed + static_cast<std::uint32_t>(octave),
+            (coordinates * frequency)...);
+        total_amplitude += amplitude;
+        amplitude *= settings.gain;
+        frequency *= settings.lacunarity;
+    }
+    return total_amplitude > 0.0f ? sum / total_amplitude : 0.0f;
+}
+
+/**
+ * \brief Sample 2d fractal noise
+ *
+ * \return the noise, in [-1, 1]
+ */
+inline float noise(noise_settings const & settings, float x, float y)
+{
+    switch (settings.kind) {
+    case noise_kind::value: return _fractal_noise<noise_kind::value>(settings, x, y);
+    case noise_kind::perlin: return _fractal_noise<noise_kind::perlin>(settings, x, y);
+    case noise_kind::cellular: return _fractal_noise<noise_kind::cellular>(settings, x, y);
+    }
+    return 0.0f;
+}
+
+/**
+ * \brief Sample 3d fractal noise
+ *
+ * \return the noise, in [-1, 1]
+ */
+inline float noise(noise_settings const & settings, float x, float y, float z)
+{
+    switch (settings.kind) {
+    case noise_kind::value: return _fractal_noise<noise_kind::value>(settings, x, y, z);
+    case noise_kind::perlin: return _fractal_noise<noise_kind::perlin>(settings, x, y, z);
+    case noise_kind::cellular: return _fractal_noise<noise_kind::cellular>(settings, x, y, z);
+    }
+    return 0.0f;
+}
+
+// octaves are the outer loop, so the inner loop over the row is one kernel
+template<noise_kind kind, bool volume>
+void _fill_noise_row(noise_settings const & settings, float * samples,
+                     std::size_t width, float x, float y, float z)
+{
+    std::fill(samples, samples + width, 0.0f);
+    float amplitude = 1.0f;
+    float total_amplitude = 0.0f;
+    float frequency = settings.frequency;
+    for (std::int32_t octave = 0; octave < settings.octaves; ++octave) {
+        std::uint32_t const seed =
+            settings.seed + static_cast<std::uint32_t>(octave);
+        for (std::size_t column = 0; column < width; ++column) {
+            float const sample_x =
+                (x + static_cast<float>(static_cast<std::int32_t>(column))) * frequency;
+            if constexpr (volume) {
+                samples[column] += amplitude * _noise_octave<kind>(
+                    seed, sample_x, y * frequency, z * frequency);
+            }
+            else {
+                samples[column] += amplitude * _noise_octave<kind>(
+                    seed, sample_x, y * frequency);
+            }
+        }
+        total_amplitude += amplitude;
+        amplitude *= settings.gain;
+        frequency *= settings.lacunarity;
+    }
+
+    float const scale = total_amplitude > 0.0f ? 1.0f / total_amplitude : 0.0f;
+    for (std::size_t column = 0; column < width; ++column) {
+        samples[column] *= scale;
+    }
+}
+
+template<noise_kind kind>
+void _fill_noise_rows(noise_settings const & settings, std::span<float> output,
+                      std::size_t width, std::size_t height, vec4f origin,
+                      bool volume, std::size_t first_row, std::size_t last_row)
+{
+    for (std::size_t row = first_row; row < last_row; ++row) {
+        float const y = origin.y + static_cast<float>(row % height);
+        float const z = origin.z + static_cast<float>(row / height);
+        float * samples = output.data() + row * width;
+        if (volume) {
+            _fill_noise_row<kind, true>(settings, samples, width, origin.x, y, z);
+        }
+        else {
+            _fill_noise_row<kind, false>(settings, samples, width, origin.x, y, z);
+        }
+    }
+}
+
+inline void _fill_noise(noise_settings const & settings, std::span<float> output,
+                        std::size_t width, std::size_t height, std::size_t depth,
+                        vec4f origin, bool volume, std::size_t threads)
+{
+    std::size_t const rows = std::min(height * depth,
+                                      width == 0 ? 0 : output.size() / width);
+    auto const fill = [&settings, output, width, height, origin, volume]
+                      (std::size_t first, std::size_t last) {
+        switch (settings.kind) {
+        case noise_kind::value:
+            _fill_noise_rows<noise_kind::value>(
+                settings, output, width, height, origin, volume, first, last);
+            break;
+        case noise_kind::perlin:
+            _fill_noise_rows<noise_kind::perlin>(
+                settings, output, width, height, origin, volume, first, last);
+            break;
+        case noise_kind::cellular:
+            _fill_noise_rows<noise_kind::cellular>(
+                settings, output, width, height, origin, volume, first, last);
+            break;
+        }
+    };
+
+    if (threads <= 1 or rows * width < limits::min_parallel_noise_cells) {
+        fill(0, rows);
+        return;
+    }
+    std::size_t const bands = std::min(threads, rows);
+    std::vector<std::future<void>> filling;
+    for (std::size_t band = 0; band < bands; ++band) {
+        filling.push_back(std::async(std::launch::async, fill,
+                                     rows * band / bands,
+                                     rows * (band + 1) / bands));
+    }
+    for (auto & band : filling) { band.get(); }
+}
+
+/**
+ * \brief Fill a 2d grid with fractal noise, row by row
+ *
+ * Bands of rows are filled on separate threads.
+ *
+ * \param settings  the noise to sample
+ * \param output    where to write the noise, which must hold width * height
+ *                  samples
+ * \param width     the number of samples in a row
+ * \param height    the number of rows
+ * \param origin    the coordinates of the first sample, in samples
+ * \param threads   the most threads to fill the grid with
+ */
+inline void fill_noise(noise_settings const & settings, std::span<float> output,
+                       std::size_t width, std::size_t height, vec2f origin = {},
+                       std::size_t threads = std::thread::hardware_concurrency())
+{
+    _fill_noise(settings, output, width, height, 1,
+                { origin.x, origin.y, 0.0f, 0.0f }, false, threads);
+}
+
+/**
+ * \brief Fill a 3d grid with fractal noise, slice by slice and row by row
+ *
+ * \param settings  the noise to sample
+ * \param output    where to write the noise, which must hold
+ *                  width * height * depth samples
+ * \param width     the number of samples in a row
+ * \param height    the number of rows in a slice
+ * \param depth     the number of slices
+ * \param origin    the coordinates of the first sample, in samples, with w
+ *                  unused
+ * \param threads   the most threads to fill the grid with
+ */
+inline void fill_noise(noise_settings const & settings, std::span<float> output,
+                       std::size_t width, std::size_t height, std::size_t depth,
+                       vec4f origin = {},
+                       std::size_t threads = std::thread::hardware_concurrency())
+{
+    _fill_noise(settings, output, width, height, depth, origin, true, threads);
+}
+
+/**
+ * \brief Load the settings of some fractal noise
+ *
+ * Every setting is optional:
+ *
+ *      [terrain.noise]
+ *      type = "perlin"     # value, perlin or cellular
+ *      seed = 1337
+ *      frequency = 0.01
+ *      octaves = 5
+ *      lacunarity = 2.0
+ *      gain = 0.5
+ *
+ * \param table             the table with the settings
+ * \param variable_path     the toml path to the settings
+ *
+ * \return the settings, or a descriptive error message
+ */
+inline expected<noise_settings, std::string>
+load_noise(toml::table const & table, std::string const & variable_path)
+{
+    auto const view = subtable_view(table, variable_path);
+    if (not view) { return unexpected(view.error()); }
+    toml::table const & settings_table = **view;
+
+    noise_settings settings;
+    auto const load_setting = [&](char const * key, auto & setting)
+        -> std::optional<std::string>
+    {
+        if (not settings_table.contains(key)) { return std::nullopt; }
+        using setting_t = std::remove_reference_t<decltype(setting)>;
+        auto result = load_value<setting_t>(settings_table, key);
+        if (not result) { return variable_path + ": "s + result.error(); }
+        setting = *result;
+        return std::nullopt;
+    };
+
+    std::string kind = std::string{ _noise_kind_names[1] };
+    std::int64_t seed = 0;
+    for (auto error : { load_setting("type", kind),
+                        load_setting("seed", seed),
+                        load_setting("frequency", settings.frequency),
+                        load_setting("octaves", settings.octaves),
+                        load_setting("lacunarity", settings.lacunarity),
+                        load_setting("gain", settings.gain) }) {
+        if (error) { return unexpected{ *error }; }
+    }
+
+    auto const name = std::find(_noise_kind_names.begin(),
+                                _noise_kind_names.end(), kind);
+    if (name == _noise_kind_names.end()) {
+        return unexpected{ variable_path + ".type must be value, perlin "s
+                           "or cellular, not "s + kind };
+    }
+    settings.kind = static_cast<noise_kind>(name - _noise_kind_names.begin());
+    settings.seed = static_cast<std::uint32_t>(seed);
+
+    if (settings.octaves < 1 or settings.octaves > limits::max_noise_octaves) {
+        return unexpected{ variable_path + ".octaves must be from 1 to "s +
+                           std::to_string(limits::max_noise_octaves) };
+    }
+    if (not (settings.frequency > 0.0f)) {
+        return unexpected{ variable_path + ".frequency must be positive"s };
+    }
+    return settings;
+}
+
+/**
+ * \brief Load the settings of some fractal noise into an output
+ *
+ * \param variable_path     the toml path to the settings
+ * \param output            where to store the settings
+ *
+ * \return a function that loads the settings from a table, and returns the
+ *         table or a descriptive error message
+ */
+inline auto load_noise(std::string const & variable_path,
+                       noise_settings & output)
+{
+    return [&variable_path, &output](toml::table const & table)
+        -> expected<toml::table, std::string>
+    {
+        auto result = load_noise(table, variable_path);
+        if (not result) { return unexpected(result.error()); }
+        output = *result;
+        return table;
+    };
+}
+}
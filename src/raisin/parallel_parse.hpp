@@ -0,0 +1,239 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+#include "raisin/sections.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// data structures
+#include <map>
+#include <set>
+#include <vector>
+#include <optional>
+
+// algorithms
+#include <algorithm>
+
+// concurrency
+#include <future>
+#include <thread>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin {
+
+using namespace std::string_literals;
+
+namespace limits {
+// documents smaller than this are parsed on the calling thread
+std::size_t constexpr min_parallel_parse_bytes = 1024 * 1024;
+}
+
+/**
+ * \brief Whether two parts of a document both have a top-level table
+ *
+ * Every section of a top-level table is in the same part, so two parts only
+ * share a table when dotted keys or an inline table before the first header
+ * define it too, as a.x = 1 or a = { x = 1 } does for [a.b]. Whether that's
+ * valid depends on the headers it meets, which only a parse of both can say.
+ */
+inline bool _shares_tables(toml::table const & first,
+                           toml::table const & second)
+{
+    for (auto && [key, node] : second) {
+        toml::node const * existing = first.get(key.str());
+        if (existing and existing->is_table() and node.is_table()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \brief Merge the tables parsed from different parts of a document
+ *
+ * \param into          the table to merge into
+ * \param from          the table to merge from
+ * \param into_arrays   top-level keys of arrays in into that were made by
+ *                      [[key]] headers, updated with those merged from from
+ * \param from_arrays   top-level keys of arrays in from that were made by
+ *                      [[key]] headers
+ *
+ * \return nothing if the tables merged, otherwise a descriptive message of
+ *         the key they both define
+ */
+inline std::optional<std::string>
+_merge_parsed(toml::table & into, toml::table && from,
+              std::set<std::string, std::less<>> & into_arrays,
+              std::set<std::string, std::less<>> const & from_arrays)
+{
+    for (auto && [key, node] : from) {
+        std::string const & name = key.str();
+
+        toml::node * existing = into.get(name);
+        if (not existing) {
+            node.visit([&into, &name](auto & value) {
+                into.insert(name, std::move(value));
+            });
+            if (from_arrays.contains(name)) { into_arrays.insert(name); }
+            continue;
+        }
+
+        // only elements of the same array of tables continue each other; a
+        // static array before [[key]] can't be appended to
+        auto * into_array = existing->as_array();
+        auto * from_array = node.as_array();
+        if (into_array and from_array and into_arrays.contains(name) and
+            from_arrays.contains(name)) {
+            for (toml::node & element : *from_array) {
+                element.visit([into_array](auto & value) {
+                    into_array->push_back(std::move(value));
+                });
+            }
+            continue;
+        }
+        return "Duplicate key "s + name;
+    }
+    return std::nullopt;
+}
+
+/**
+ * \brief Parse a toml document on several threads
+ *
+ * The document is split into parts at top-level headers, with every section
+ * of a top-level table in the same part, so that each part can be parsed on
+ * its own. Top-level arrays of tables are also split between their [[array]]
+ * headers. The parts are parsed concurrently, then merged in document order.
+ * A document whose tables are extended across parts, by dotted keys or inline
+ * tables before the first header, is parsed again serially, so that it's
+ * accepted or rejected exactly as a serial parse would.
+ *
+ * \param document      the text of the document
+ * \param source_path   the path of the document, for error messages
+ * \param threads       the most threads to parse with
+ *
+ * \return the parsed table, or a descriptive error message
+ */
+inline expected<toml::table, std::string>
+parse_parallel(std::string_view document,
+               std::string const & source_path = ""s,
+               std::size_t threads = std::thread::hardware_concurrency())
+{
+    std::vector<toml_section> const whole{
+        toml_section{ {}, {}, false, 0, document.size(), 1 } };
+    if (threads <= 1 or document.size() < limits::min_parallel_parse_bytes) {
+        return parse_sections(document, whole, source_path);
+    }
+
+    // group sections by their top-level key, in order of first appearance
+    std::vector<std::string_view> keys;
+    std::map<std::string_view, std::vector<toml_section>> groups;
+    for (toml_section const & section : split_sections(document)) {
+        auto & group = groups[section.key];
+        if (group.empty()) { keys.push_back(section.key); }
+        group.push_back(section);
+    }
+
+    // split groups into units that parse on their own; a top-level array of
+    // tables splits before each of its [[key]] headers
+    std::vector<std::vector<toml_section>> units;
+    std::vector<std::size_t> unit_bytes;
+    for (std::string_view key : keys) {
+        auto const & group = groups[key];
+        auto const starts_element = [key](toml_section const & section) {
+            return section.is_array_of_tables and section.header == key;
+        };
+        bool const splittable = not key.empty() and
+                                starts_element(group.front());
+
+        for (toml_section const & section : group) {
+            if (units.empty() or (splittable and starts_element(section)) or
+                &section == &group.front()) {
+                units.emplace_back();
+                unit_bytes.push_back(0);
+            }
+            units.back().push_back(section);
+            unit_bytes.back() += section.end - section.begin;
+        }
+    }
+
+    // join consecutive units into one part per thread of roughly equal size
+    std::size_t const part_size = document.size() / threads + 1;
+    std::vector<std::vector<toml_section>> parts(1);
+    std::size_t current_size = 0;
+    for (std::size_t i = 0; i < units.size(); ++i) {
+        if (current_size >= part_size and parts.size() < threads) {
+            parts.emplace_back();
+            current_size = 0;
+        }
+        parts.back().insert(parts.back().end(),
+                            units[i].begin(), units[i].end());
+        current_size += unit_bytes[i];
+    }
+
+    // the top-level arrays of tables each part has elements of
+    std::vector<std::set<std::string, std::less<>>> part_arrays(parts.size());
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        for (toml_section const & section : parts[i]) {
+            if (section.is_array_of_tables and section.header == section.key) {
+                part_arrays[i].emplace(section.key);
+            }
+        }
+    }
+
+    std::vector<std::future<expected<toml::table, std::string>>> parsing;
+    for (auto const & part : parts) {
+        parsing.push_back(std::async(std::launch::async,
+            [document, &part, &source_path] {
+                return parse_sections(document, part, source_path);
+            }));
+    }
+
+    // merge in document order, reporting the first error in the document
+    toml::table merged;
+    std::set<std::string, std::less<>> merged_arrays;
+    std::optional<std::string> error;
+    bool shared = false;
+    for (std::size_t i = 0; i < parsing.size(); ++i) {
+        auto result = parsing[i].get();
+        if (error or shared) { continue; }
+        if (not result) { error = result.error(); continue; }
+        shared = _shares_tables(merged, *result);
+        if (shared) { continue; }
+        error = _merge_parsed(merged, std::move(*result),
+                              merged_arrays, part_arrays[i]);
+    }
+    if (error) { return unexpected{ *error }; }
+
+    // a table split between parts is accepted or rejected as toml++ would
+    // the whole document
+    if (shared) { return parse_sections(document, whole, source_path); }
+    return merged;
+}
+
+/**
+ * \brief Parse a toml file on several threads
+ *
+ * \param config_path   the path to the config file.
+ * \param threads       the most threads to parse with
+ *
+ * \return The parsed toml table if parsing was successful, otherwise the
+ *         error message for why parsing failed.
+ *
+ * \note This gives the same table as parse_file, but large files parse in
+ *       parallel. See parse_parallel for how the file is split.
+ */
+inline expected<toml::table, std::string>
+parse_file_parallel(std::string const & config_path,
+                    std::size_t threads = std::thread::hardware_concurrency())
+{
+    auto text = read_text_file(config_path);
+    if (not text) { return unexpected(text.error()); }
+    return parse_parallel(*text, config_path, threads);
+}
+}
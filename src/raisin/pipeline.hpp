@@ -0,0 +1,295 @@
+#pragma once
+#include "raisin/future.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+
+// data structures
+#include <tuple>
+#include <array>
+#include <optional>
+#include <utility>
+
+// type constraints
+#include <concepts>
+#include <type_traits>
+#include <functional>
+
+// concurrency
+#include <future>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin {
+
+/**
+ * \brief A stage of a loading pipeline
+ *
+ * Loaders take the table to load from, and either return it as an expected
+ * table result (e.g. load), or just return it when they can't fail (e.g.
+ * load_or_else).
+ */
+template<typename loader_t>
+concept loader = std::invocable<loader_t const &, toml::table const &>;
+
+/**
+ * \brief A loader that all_of runs on a worker thread
+ */
+template<loader loader_t>
+struct concurrent_loader {
+    loader_t load;
+
+    decltype(auto) operator()(toml::table const & table) const
+    {
+        return std::invoke(load, table);
+    }
+};
+
+/**
+ * \brief Mark a loader to be run on a worker thread by all_of
+ *
+ * \param load  a loader whose outputs aren't written by any other loader
+ *
+ * \note This is only worth it for large loads, such as big arrays or whole
+ *       subtables, since each concurrent loader starts its own thread.
+ */
+template<loader loader_t>
+concurrent_loader<loader_t> concurrently(loader_t load)
+{
+    return { std::move(load) };
+}
+
+template<loader loader_t>
+std::optional<std::string>
+_loader_error(loader_t const & load, toml::table const & table)
+{
+    using result_t = std::invoke_result_t<loader_t const &,
+                                          toml::table const &>;
+    if constexpr (std::same_as<std::remove_cvref_t<result_t>, toml::table>) {
+        std::invoke(load, table);
+        return std::nullopt;
+    }
+    else {
+        auto result = std::invoke(load, table);
+        if (not result) { return result.error(); }
+        return std::nullopt;
+    }
+}
+
+// plain loaders are run in order when their result is collected
+template<typename loader_t>
+struct _loader_task {
+    struct type {};
+
+    static type start(loader_t const &, toml::table const &) { return {}; }
+
+    static std::optional<std::string>
+    finish(type &, loader_t const & load, toml::table const & table)
+    {
+        return _loader_error(load, table);
+    }
+};
+
+// concurrent loaders are started up front and joined when collected
+template<typename loader_t>
+struct _loader_task<concurrent_loader<loader_t>> {
+    using type = std::future<std::optional<std::string>>;
+
+    static type start(concurrent_loader<loader_t> const & concurrent,
+                      toml::table const & table)
+    {
+        return std::async(std::launch::async, [&concurrent, &table] {
+            return _loader_error(concurrent.load, table);
+        });
+    }
+
+    static std::optional<std::string>
+    finish(type & task, concurrent_loader<loader_t> const &,
+           toml::table const &)
+    {
+        return task.get();
+    }
+};
+
+inline void _append_error(std::string & errors,
+                          std::optional<std::string> const & error)
+{
+    if (not error) { return; }
+    if (not errors.empty()) { errors += '\n'; }
+    errors += *error;
+}
+
+/**
+ * \brief Run every loader against the same table, reporting all errors
+ *
+ * \param loaders   the loaders to run, any of which may be wrapped with
+ *                  concurrently to run it on a worker thread
+ *
+ * \return a function taking a toml::table and returning an expected table
+ *         result. Unlike chaining loaders with and_then, every loader is run
+ *         even when an earlier one fails, and the error is the error of each
+ *         failed loader, one per line, in the order they were given.
+ *
+ * \note Loaders run concurrently must write to outputs that no other loader
+ *       writes to.
+ */
+template<typename... loader_t>
+    requires (loader<loader_t> and ...)
+auto all_of(loader_t... loaders)
+{
+    return [loaders...](toml::table const & table)
+        -> expected<toml::table, std::string>
+    {
+        // start the concurrent loaders before running the rest in order
+        std::tuple<typename _loader_task<loader_t>::type...> tasks{
+            _loader_task<loader_t>::start(loaders, table)... };
+
+        std::string errors;
+        std::apply([&](auto &... task) {
+            (_append_error(errors,
+                _loader_task<loader_t>::finish(task, loaders, table)), ...);
+        }, tasks);
+
+        if (not errors.empty()) { return unexpected{ errors }; }
+        return table;
+    };
+}
+
+/**
+ * \brief A loader that can be fused with other stages into one pass
+ *
+ * Besides loading from a table, a fusable stage can load from a node that's
+ * already been found in the table, or from null when it doesn't exist.
+ * load, load_or_else and the flag loaders all return fusable stages.
+ */
+template<typename stage_t>
+concept fusable = loader<stage_t> and
+requires(stage_t const & stage, toml::table const & table,
+         toml::node const * node)
+{
+    { stage.variable_path } -> std::convertible_to<std::string_view>;
+    { stage.load_node(table, node) }
+        -> std::same_as<std::optional<std::string>>;
+};
+
+/**
+ * \brief A sequence of stages that load from the same table
+ *
+ * Rather than each stage looking up its own path and returning a copy of the
+ * table, the stages with plain keys are dispatched from a single pass over
+ * the table's entries. Stages with dotted or indexed paths still look up
+ * their own path.
+ *
+ * Like all_of, every stage is run even when an earlier one fails, and the
+ * error is the error of each failed stage, one per line.
+ */
+template<fusable... stage_t>
+class fused_loader {
+public:
+    explicit fused_loader(std::tuple<stage_t...> stages)
+        : stages{ std::move(stages) }
+    {
+    }
+
+    /**
+     * \brief Run every stage against a table
+     *
+     * \return nothing on success, otherwise the errors of each failed stage
+     */
+    std::optional<std::string> load_fields(toml::table const & table) const
+    {
+        std::size_t constexpr count = sizeof...(stage_t);
+        auto const keys = std::apply([](stage_t const &... stage) {
+            return std::array<std::string_view, count>{
+                std::string_view{ stage.variable_path }... };
+        }, stages);
+
+        std::array<bool, count> plain;
+        std::array<toml::node const *, count> nodes{};
+        std::size_t unfound = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            plain[i] = keys[i].find_first_of(".[") == std::string_view::npos;
+            if (plain[i]) { ++unfound; }
+            else { nodes[i] = table.at_path(keys[i]).node(); }
+        }
+
+        for (auto && [key, node] : table) {
+            if (unfound == 0) { break; }
+            std::string_view const name = key.str();
+            for (std::size_t i = 0; i < count; ++i) {
+                if (plain[i] and not nodes[i] and keys[i] == name) {
+                    nodes[i] = &node;
+                    --unfound;
+                }
+            }
+        }
+
+        std::string errors;
+        [&]<std::size_t... i>(std::index_sequence<i...>) {
+            (_append_error(errors,
+                std::get<i>(stages).load_node(table, nodes[i])), ...);
+        }(std::index_sequence_for<stage_t...>{});
+
+        if (errors.empty()) { return std::nullopt; }
+        return errors;
+    }
+
+    expected<toml::table, std::string>
+    operator()(toml::table const & table) const
+    {
+        auto errors = load_fields(table);
+        if (errors) { return unexpected{ *errors }; }
+        return table;
+    }
+
+    /**
+     * \brief Run every stage against a table without copying it
+     *
+     * \note This lets a pipeline follow subtable_view in an and_then chain.
+     */
+    expected<toml::table const *, std::string>
+    operator()(toml::table const * table) const
+    {
+        auto errors = load_fields(*table);
+        if (errors) { return unexpected{ *errors }; }
+        return table;
+    }
+
+    template<fusable... lhs_t, fusable rhs_t>
+    friend fused_loader<lhs_t..., rhs_t>
+    operator|(fused_loader<lhs_t...> lhs, rhs_t rhs);
+
+private:
+    std::tuple<stage_t...> stages;
+};
+
+/**
+ * \brief Fuse two stages that load from the same table
+ *
+ *      auto result = subtable_view(table, "window")
+ *          .and_then(load("title", title)
+ *                  | load("width", width)
+ *                  | load_or_else("x", x, anywhere));
+ */
+template<fusable lhs_t, fusable rhs_t>
+fused_loader<lhs_t, rhs_t> operator|(lhs_t lhs, rhs_t rhs)
+{
+    return fused_loader<lhs_t, rhs_t>{
+        std::tuple{ std::move(lhs), std::move(rhs) } };
+}
+
+/**
+ * \brief Add a stage to a fused pipeline
+ */
+template<fusable... lhs_t, fusable rhs_t>
+fused_loader<lhs_t..., rhs_t>
+operator|(fused_loader<lhs_t...> lhs, rhs_t rhs)
+{
+    return fused_loader<lhs_t..., rhs_t>{
+        std::tuple_cat(std::move(lhs.stages),
+                       std::tuple{ std::move(rhs) }) };
+}
+}
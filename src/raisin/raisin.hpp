@@ -2,3 +2,22 @@
 
 #include "raisin/fundamental_types.hpp"
 #include "raisin/flags.hpp"
+#include "raisin/log.hpp"
+#include "raisin/diagnostics.hpp"
+#include "raisin/pipeline.hpp"
+#include "raisin/hash.hpp"
+#include "raisin/compact.hpp"
+#include "raisin/sections.hpp"
+#include "raisin/lazy_document.hpp"
+#include "raisin/parallel_parse.hpp"
+#include "raisin/incremental_document.hpp"
+#include "raisin/native_parse.hpp"
+#include "raisin/mapped_file.hpp"
+#include "raisin/sidecar.hpp"
+#include "raisin/cvar.hpp"
+#include "raisin/vec.hpp"
+#include "raisin/scene.hpp"
+#include "raisin/tweens.hpp"
+#include "raisin/navigation.hpp"
+#include "raisin/fixed.hpp"
+#include "raisin/noise.hpp"
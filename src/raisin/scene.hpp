@@ -0,0 +1,265 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+#include "raisin/vec.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+// data structures
+#include <map>
+#include <span>
+#include <vector>
+#include <optional>
+
+// algorithms
+#include <algorithm>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+inline namespace raisin {
+
+using namespace std::string_literals;
+
+/**
+ * \brief A flat hierarchy of transforms in depth-first order
+ *
+ * Nodes are stored as parallel arrays, ordered so that every node comes after
+ * its parent and each node's subtree is the contiguous range of nodes up to
+ * its subtree end. Updating world transforms is one pass from the front that
+ * jumps to each dirty node and recomputes its subtree in order, so static
+ * nodes are never touched beyond their dirty flag:
+ *
+ *      auto scene = raisin::load_scene(table, "level.nodes");
+ *      auto turret = scene->find("tank.turret");
+ *      scene->set_local(*turret, raisin::make_affine({ 0, 4 }, aim, { 1, 1 }));
+ *      scene->update();
+ *      draw(scene->worlds());
+ */
+class transform_hierarchy {
+public:
+    static std::int32_t constexpr no_parent = -1;
+
+    /**
+     * \brief Add a node after every other node
+     *
+     * \param parent    the index of the parent, or no_parent for a root
+     * \param local     the transform relative to the parent
+     * \param name      a name to find the node by
+     *
+     * \return the index of the node, or a descriptive error message if the
+     *         parent doesn't exist or isn't the last subtree, since children
+     *         must be added in depth-first order
+     */
+    expected<std::size_t, std::string>
+    add(std::int32_t parent, affine2f const & local, std::string name = ""s)
+    {
+        std::size_t const index = size();
+        if (parent != no_parent) {
+            if (parent < 0 or static_cast<std::size_t>(parent) >= index) {
+                return unexpected{ "There's no node "s +
+                                   std::to_string(parent) + " to add to"s };
+            }
+            if (subtree_ends[parent] != index) {
+                return unexpected{ "Children of node "s +
+                                   std::to_string(parent) + " must be added "s
+                                   "in depth-first order"s };
+            }
+        }
+
+        parents.push_back(parent);
+        locals.push_back(local);
+        world_transforms.push_back(local);
+        dirty.push_back(1);
+        subtree_ends.push_back(index + 1);
+        for (std::int32_t ancestor = parent; ancestor != no_parent;
+             ancestor = parents[ancestor]) {
+            subtree_ends[ancestor] = index + 1;
+        }
+        if (not name.empty()) { indices.emplace(name, index); }
+        names.push_back(std::move(name));
+        return index;
+    }
+
+    std::size_t size() const { return parents.size(); }
+
+    /**
+     * \brief Find a node by its name
+     */
+    std::optional<std::size_t> find(std::string_view name) const
+    {
+        auto const found = indices.find(name);
+        if (found == indices.end()) { return std::nullopt; }
+        return found->second;
+    }
+
+    std::int32_t parent(std::size_t index) const { return parents[index]; }
+    std::string const & name(std::size_t index) const { return names[index]; }
+    affine2f const & local(std::size_t index) const { return locals[index]; }
+
+    /**
+     * \brief The transform of a node relative to the scene, as of the last
+     *        update
+     */
+    affine2f const & world(std::size_t index) const
+    {
+        return world_transforms[index];
+    }
+
+    /**
+     * \brief Every world transform, in node order, as of the last update
+     */
+    std::span<affine2f const> worlds() const { return world_transforms; }
+
+    /**
+     * \brief The end of the contiguous range of a node and its descendants
+     */
+    std::size_t subtree_end(std::size_t index) const
+    {
+        return subtree_ends[index];
+    }
+
+    /**
+     * \brief Change the transform of a node relative to its parent
+     *
+     * \note The world transforms of the node and its subtree change on the
+     *       next update.
+     */
+    void set_local(std::size_t index, affine2f const & local)
+    {
+        locals[index] = local;
+        dirty[index] = 1;
+    }
+
+    /**
+     * \brief Recompute the world transforms of every changed subtree
+     *
+     * \return the number of world transforms that were recomputed
+     */
+    std::size_t update()
+    {
+        std::size_t recomputed = 0;
+        auto next = dirty.begin();
+        while ((next = std::find(next, dirty.end(), 1)) != dirty.end()) {
+            std::size_t const first = next - dirty.begin();
+            std::size_t const last = subtree_ends[first];
+
+            // every parent in the subtree comes before its children, and the
+            // subtree root's parent is already up to date
+            for (std::size_t i = first; i < last; ++i) {
+                std::int32_t const parent = parents[i];
+                world_transforms[i] = parent == no_parent ? locals[i] :
+                    compose(world_transforms[parent], locals[i]);
+            }
+            std::fill(dirty.begin() + first, dirty.begin() + last, 0);
+            recomputed += last - first;
+            next = dirty.begin() + last;
+        }
+        return recomputed;
+    }
+
+private:
+    std::vector<std::int32_t> parents;
+    std::vector<affine2f> locals;
+    std::vector<affine2f> world_transforms;
+    std::vector<std::uint8_t> dirty;
+    std::vector<std::size_t> subtree_ends;
+    std::vector<std::string> names;
+    std::map<std::string, std::size_t, std::less<>> indices;
+};
+
+inline std::optional<std::string>
+_load_scene_node(toml::table const & node, std::string const & path,
+                 std::string const & name, std::int32_t parent,
+                 transform_hierarchy & scene)
+{
+    vec2f position;
+    float rotation = 0.0f;
+    vec2f scale{ 1.0f, 1.0f };
+
+    if (node.contains("position")) {
+        auto result = load_value<vec2f>(node, "position");
+        if (not result) { return path + ": "s + result.error(); }
+        position = *result;
+    }
+    if (node.contains("rotation")) {
+        auto result = load_value<float>(node, "rotation");
+        if (not result) { return path + ": "s + result.error(); }
+        rotation = *result;
+    }
+    if (auto const uniform = node["scale"].value<float>()) {
+        scale = { *uniform, *uniform };
+    }
+    else if (node.contains("scale")) {
+        auto result = load_value<vec2f>(node, "scale");
+        if (not result) { return path + ": "s + result.error(); }
+        scale = *result;
+    }
+
+    auto index = scene.add(parent, make_affine(position, rotation, scale), name);
+    if (not index) { return index.error(); }
+
+    if (not node.contains("children")) { return std::nullopt; }
+    auto const * children = node["children"].as_table();
+    if (not children) {
+        return path + ".children must be a table of nodes"s;
+    }
+    for (auto && [key, child] : *children) {
+        std::string const child_path = path + ".children."s + key.str();
+        auto const * child_table = child.as_table();
+        if (not child_table) { return child_path + " must be a table"s; }
+        auto error = _load_scene_node(*child_table, child_path,
+                                      name + "."s + key.str(),
+                                      static_cast<std::int32_t>(*index), scene);
+        if (error) { return error; }
+    }
+    return std::nullopt;
+}
+
+/**
+ * \brief Load a scene into a flat transform hierarchy
+ *
+ * A scene is a table of named nodes. Each node has an optional position,
+ * rotation in degrees, and scale (a number or a vector), and an optional
+ * table of named children:
+ *
+ *      [level.nodes.tank]
+ *      position = [120, 80]
+ *
+ *      [level.nodes.tank.children.turret]
+ *      position = [0, 4]
+ *      rotation = 90
+ *
+ * Nodes are named by their path from the scene, e.g. "tank.turret".
+ *
+ * \param table             the table with the scene
+ * \param variable_path     the toml path to the scene
+ *
+ * \return the hierarchy, or a descriptive error message
+ */
+inline expected<transform_hierarchy, std::string>
+load_scene(toml::table const & table, std::string const & variable_path)
+{
+    auto const nodes = subtable_view(table, variable_path);
+    if (not nodes) { return unexpected(nodes.error()); }
+
+    transform_hierarchy scene;
+    for (auto && [key, node] : **nodes) {
+        std::string const path = variable_path + "."s + key.str();
+        auto const * node_table = node.as_table();
+        if (not node_table) {
+            return unexpected{ path + " must be a table"s };
+        }
+        auto error = _load_scene_node(*node_table, path, key.str(),
+                                      transform_hierarchy::no_parent, scene);
+        if (error) { return unexpected{ *error }; }
+    }
+    scene.update();
+    return scene;
+}
+}
@@ -4,3 +4,9 @@
 #include "raisin/sdl/window.hpp"
 #include "raisin/sdl/renderer.hpp"
 #include "raisin/sdl/color.hpp"
+#include "raisin/sdl/animation.hpp"
+#include "raisin/sdl/audio.hpp"
+#include "raisin/sdl/music.hpp"
+#include "raisin/sdl/latency.hpp"
+#include "raisin/sdl/render_stats.hpp"
+#include "raisin/sdl/bitmap.hpp"
@@ -0,0 +1,444 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+
+// frameworks
+#include <SDL2/SDL.h>
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+// data structures
+#include <map>
+#include <span>
+#include <vector>
+#include <optional>
+
+// algorithms
+#include <algorithm>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin::sdl {
+
+using namespace std::string_literals;
+
+/**
+ * \brief What an animation does after its last frame
+ */
+enum class loop_mode : std::uint8_t {
+    // start again from the first frame
+    loop,
+
+    // stay on the last frame
+    once,
+
+    // play backwards to the first frame, then forwards again
+    ping_pong
+};
+
+/**
+ * \brief An animation baked into a range of an animation set's frames
+ */
+struct animation {
+    // the range of the animation's frames in the set's frame table
+    std::uint32_t first = 0;
+    std::uint32_t count = 0;
+
+    // the total duration, in seconds
+    float length = 0.0f;
+
+    // frames per second if every frame has the same duration, otherwise 0
+    float rate = 0.0f;
+
+    // whether the animation repeats; ping-pong animations are baked as their
+    // forward frames then their backward frames, and repeat
+    bool repeats = true;
+
+    std::string sheet;
+};
+
+/**
+ * \brief Animations baked into one contiguous table of frames
+ *
+ * Each frame is a precomputed source rectangle on its sprite sheet, with the
+ * time since the start of its animation at which the frame ends. Look up an
+ * animation by name once, when a sprite starts playing it, and refer to it by
+ * id after that.
+ */
+class animation_set {
+public:
+    /**
+     * \brief Find an animation's id by its name
+     */
+    std::optional<std::uint32_t> find(std::string_view name) const
+    {
+        auto const found = ids.find(name);
+        if (found == ids.end()) { return std::nullopt; }
+        return found->second;
+    }
+
+    animation const & operator[](std::uint32_t id) const
+    {
+        return animations[id];
+    }
+
+    std::size_t size() const { return animations.size(); }
+
+    /**
+     * \brief The source rectangle of every frame of every animation
+     */
+    std::span<SDL_Rect const> frames() const { return rects; }
+
+    /**
+     * \brief The time each frame ends, from the start of its animation
+     */
+    std::span<float const> frame_ends() const { return ends; }
+
+    /**
+     * \brief Bake an animation and add it to the set
+     *
+     * \param name          the name to find the animation by
+     * \param frame_rects   the source rectangle of each frame, in order
+     * \param durations     the duration of each frame, in seconds
+     * \param mode          what the animation does after its last frame
+     * \param sheet         the sprite sheet the rectangles are on
+     *
+     * \return the animation's id, or a descriptive error message if it has
+     *         no frames, or not one positive duration for each frame
+     */
+    expected<std::uint32_t, std::string>
+    add(std::string const & name, std::span<SDL_Rect const> frame_rects,
+        std::span<float const> durations, loop_mode mode,
+        std::string sheet = ""s)
+    {
+        if (frame_rects.empty()) {
+            return unexpected{ "Animation "s + name + " has no frames"s };
+        }
+        if (durations.size() != frame_rects.size() or
+            std::ranges::any_of(durations,
+                                [](float duration) { return duration <= 0; })) {
+            return unexpected{ "Animation "s + name + " must have a positive "s
+                               "duration for each of its "s +
+                               std::to_string(frame_rects.size()) +
+                               " frames"s };
+        }
+
+        animation baked;
+        baked.first = static_cast<std::uint32_t>(rects.size());
+        baked.repeats = mode != loop_mode::once;
+        baked.sheet = std::move(sheet);
+
+        float time = 0.0f;
+        auto const add_frame = [&](std::size_t frame) {
+            time += durations[frame];
+            rects.push_back(frame_rects[frame]);
+            ends.push_back(time);
+        };
+        for (std::size_t frame = 0; frame < frame_rects.size(); ++frame) {
+            add_frame(frame);
+        }
+        if (mode == loop_mode::ping_pong) {
+            for (std::size_t frame = frame_rects.size() - 1; frame-- > 1; ) {
+                add_frame(frame);
+            }
+        }
+        baked.count = static_cast<std::uint32_t>(rects.size()) - baked.first;
+        baked.length = time;
+
+        bool const uniform = std::ranges::all_of(durations,
+            [&durations](float duration) { return duration == durations[0]; });
+        baked.rate = uniform ? 1.0f / durations[0] : 0.0f;
+
+        std::uint32_t const id = static_cast<std::uint32_t>(animations.size());
+        animations.push_back(std::move(baked));
+        ids.insert_or_assign(name, id);
+        return id;
+    }
+
+private:
+    std::vector<animation> animations;
+    std::vector<SDL_Rect> rects;
+    std::vector<float> ends;
+    std::map<std::string, std::uint32_t, std::less<>> ids;
+};
+
+inline expected<loop_mode, std::string>
+_load_loop_mode(toml::table const & table, std::string const & variable_path)
+{
+    auto const name = table["loop"].value_or("loop"s);
+    if (name == "loop") { return loop_mode::loop; }
+    if (name == "once") { return loop_mode::once; }
+    if (name == "ping-pong") { return loop_mode::ping_pong; }
+    std::string const description =
+        variable_path + ".loop must be loop, once or ping-pong, not "s + name;
+    return unexpected{ description };
+}
+
+inline std::optional<std::string>
+_load_animation(toml::table const & table, std::string const & name,
+                std::string const & variable_path, animation_set & set)
+{
+    int frame_size[2];
+    auto size_result = load_array(table, "frame-size", frame_size);
+    if (not size_result or *size_result != std::end(frame_size)) {
+        return variable_path + ".frame-size must be [width, height]"s;
+    }
+    int origin[2] = { 0, 0 };
+    if (table.contains("origin")) {
+        auto origin_result = load_array(table, "origin", origin);
+        if (not origin_result or *origin_result != std::end(origin)) {
+            return variable_path + ".origin must be [x, y]"s;
+        }
+    }
+
+    auto const count = table["frame-count"].value<int>();
+    if (not count or *count <= 0) {
+        return variable_path + ".frame-count must be a positive integer"s;
+    }
+    int const columns = table["columns"].value_or(*count);
+    if (columns <= 0) {
+        return variable_path + ".columns must be a positive integer"s;
+    }
+
+    std::vector<float> durations;
+    if (auto const * array = table["durations"].as_array()) {
+        for (toml::node const & duration : *array) {
+            durations.push_back(duration.value_or(0.0f));
+        }
+    }
+    else {
+        durations.assign(*count, table["duration"].value_or(0.0f));
+    }
+    if (durations.size() != static_cast<std::size_t>(*count) or
+        std::ranges::any_of(durations, [](float d) { return d <= 0.0f; })) {
+        return variable_path + " must have a positive duration, or "s
+               "durations for each of its "s + std::to_string(*count) +
+               " frames"s;
+    }
+
+    auto const mode = _load_loop_mode(table, variable_path);
+    if (not mode) { return mode.error(); }
+
+    std::vector<SDL_Rect> rects;
+    rects.reserve(*count);
+    for (int frame = 0; frame < *count; ++frame) {
+        rects.push_back({ origin[0] + (frame % columns) * frame_size[0],
+                          origin[1] + (frame / columns) * frame_size[1],
+                          frame_size[0], frame_size[1] });
+    }
+    auto const added = set.add(name, rects, durations, *mode,
+                               table["sheet"].value_or(""s));
+    if (not added) { return added.error(); }
+    return std::nullopt;
+}
+
+/**
+ * \brief Load sprite-sheet animations and bake them into frame tables
+ *
+ * Each animation is a table of its sheet, frame size, frame count and frame
+ * durations in seconds, with an optional origin of its first frame, number of
+ * columns of frames on the sheet, and loop mode:
+ *
+ *      [animations.walk]
+ *      sheet = "hero.png"
+ *      frame-size = [32, 48]
+ *      frame-count = 6
+ *      columns = 3
+ *      duration = 0.1            # or durations = [0.1, 0.2, ...]
+ *      loop = "ping-pong"        # loop, once or ping-pong
+ *
+ * \param table             the table with the animations
+ * \param variable_path     the toml path to the table of animations
+ *
+ * \return the baked animations, or a descriptive error message
+ */
+inline expected<animation_set, std::string>
+load_animations(toml::table const & table, std::string const & variable_path)
+{
+    auto const animations = subtable_view(table, variable_path);
+    if (not animations) { return unexpected(animations.error()); }
+
+    animation_set set;
+    for (auto && [key, node] : **animations) {
+        std::string const path = variable_path + "."s + key.str();
+        auto const * animation_table = node.as_table();
+        if (not animation_table) {
+            return unexpected{ path + " must be a table"s };
+        }
+        auto error = _load_animation(*animation_table, key.str(), path, set);
+        if (error) { return unexpected{ *error }; }
+    }
+    return set;
+}
+
+/**
+ * \brief The playback state of many animated sprites
+ *
+ * Each sprite's state is a slot in parallel arrays, so advancing every
+ * sprite is two passes over contiguous floats and integers:
+ *
+ *      raisin::sdl::animation_players players{ *animations };
+ *      auto const walk = *animations->find("walk");
+ *      auto const hero = players.add(walk);
+ *
+ *      players.advance(frame_seconds);
+ *      SDL_RenderCopy(renderer, sheet, &players.frame(hero), &destination);
+ *
+ * \note The players refer to the animation set, so it must outlive them.
+ */
+class animation_players {
+public:
+    explicit animation_players(animation_set const & set)
+        : set{ set }
+    {
+    }
+
+    /**
+     * \brief Start a sprite playing an animation
+     *
+     * \param id        the animation to play
+     * \param time      how far into the animation to start, in seconds
+     *
+     * \return the sprite's slot
+     */
+    std::size_t add(std::uint32_t id, float time = 0.0f)
+    {
+        std::size_t const slot = times.size();
+        times.push_back(0.0f);
+        lengths.push_back(0.0f);
+        rates.push_back(0.0f);
+        repeats.push_back(0);
+        firsts.push_back(0);
+        counts.push_back(0);
+        frame_indices.push_back(0);
+        play(slot, id, time);
+        return slot;
+    }
+
+    /**
+     * \brief Switch a sprite to an animation, from the start
+     */
+    void play(std::size_t slot, std::uint32_t id, float time = 0.0f)
+    {
+        animation const & played = set[id];
+        lengths[slot] = played.length;
+        rates[slot] = played.rate;
+        repeats[slot] = played.repeats;
+        firsts[slot] = played.first;
+        counts[slot] = played.count;
+        times[slot] = time;
+        seek(slot);
+    }
+
+    /**
+     * \brief Stop animating a sprite
+     *
+     * \note The last sprite moves into the removed sprite's slot.
+     */
+    void remove(std::size_t slot)
+    {
+        auto const swap_remove = [slot](auto & values) {
+            values[slot] = values.back();
+            values.pop_back();
+        };
+        swap_remove(times);
+        swap_remove(lengths);
+        swap_remove(rates);
+        swap_remove(repeats);
+        swap_remove(firsts);
+        swap_remove(counts);
+        swap_remove(frame_indices);
+    }
+
+    std::size_t size() const { return times.size(); }
+
+    /**
+     * \brief Advance every sprite's animation
+     *
+     * \param seconds   the time since the last advance
+     */
+    void advance(float seconds)
+    {
+        std::size_t const count = times.size();
+
+        // advance and wrap the time of every sprite, without branches
+        for (std::size_t i = 0; i < count; ++i) {
+            float const time = times[i] + seconds;
+            float const wrapped = time - std::floor(time / lengths[i]) * lengths[i];
+            times[i] = repeats[i] ? wrapped : std::min(time, lengths[i]);
+        }
+
+        // find each sprite's frame: directly for uniform frame durations, and
+        // by scanning forward from a guess otherwise
+        std::span<float const> const ends = set.frame_ends();
+        for (std::size_t i = 0; i < count; ++i) {
+            std::uint32_t frame = std::min(
+                    static_cast<std::uint32_t>(times[i] * rates[i]),
+                    counts[i] - 1);
+            while (frame + 1 < counts[i] and
+                   ends[firsts[i] + frame] <= times[i]) {
+                ++frame;
+            }
+            frame_indices[i] = firsts[i] + frame;
+        }
+    }
+
+    /**
+     * \brief The source rectangle of a sprite's current frame
+     */
+    SDL_Rect const & frame(std::size_t slot) const
+    {
+        return set.frames()[frame_indices[slot]];
+    }
+
+    /**
+     * \brief The index in the animation set's frames of every sprite's
+     *        current frame, by slot
+     */
+    std::span<std::uint32_t const> frames() const { return frame_indices; }
+
+    /**
+     * \brief Whether a sprite's animation has played to its end and stopped
+     */
+    bool finished(std::size_t slot) const
+    {
+        return not repeats[slot] and times[slot] >= lengths[slot];
+    }
+
+private:
+    animation_set const & set;
+
+    std::vector<float> times;
+    std::vector<float> lengths;
+    std::vector<float> rates;
+    std::vector<std::uint8_t> repeats;
+    std::vector<std::uint32_t> firsts;
+    std::vector<std::uint32_t> counts;
+    std::vector<std::uint32_t> frame_indices;
+
+    // wrap or clamp a sprite's time, and find its frame from scratch
+    void seek(std::size_t slot)
+    {
+        float time = times[slot];
+        time = repeats[slot] ?
+            time - std::floor(time / lengths[slot]) * lengths[slot] :
+            std::min(time, lengths[slot]);
+        times[slot] = time;
+
+        std::uint32_t frame = 0;
+        std::span<float const> const ends = set.frame_ends();
+        while (frame + 1 < counts[slot] and
+               ends[firsts[slot] + frame] <= time) {
+            ++frame;
+        }
+        frame_indices[slot] = firsts[slot] + frame;
+    }
+};
+}
@@ -0,0 +1,531 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+
+// frameworks
+#include <SDL2/SDL.h>
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+
+// data structures
+#include <map>
+#include <span>
+#include <array>
+#include <vector>
+#include <optional>
+
+// algorithms
+#include <algorithm>
+
+// i/o
+#include <filesystem>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin::limits {
+// the zero crossings on each side of the windowed-sinc resampling kernel
+std::size_t constexpr sinc_zero_crossings = 16;
+
+// the fractional positions the windowed-sinc kernel is tabulated at
+std::size_t constexpr sinc_phases = 512;
+}
+
+namespace raisin::sdl {
+
+using namespace std::string_literals;
+
+/**
+ * \brief How sounds are resampled to the device's rate
+ */
+enum class resample_quality : std::uint8_t {
+    // interpolate linearly between neighbouring frames
+    linear,
+
+    // filter with a Blackman-windowed sinc, which doesn't alias
+    sinc
+};
+
+/**
+ * \brief A sound converted to a device's exact format, rate and channels
+ *
+ * The samples are stored 16-byte aligned and can be copied or mixed straight
+ * into the device's buffer by the audio callback.
+ */
+class sound {
+public:
+    sound() = default;
+
+    sound(std::size_t size, std::uint32_t frames)
+        : blocks((size + sizeof(block) - 1) / sizeof(block)),
+          size_in_bytes{ size }, frame_count{ frames }
+    {
+    }
+
+    std::span<std::uint8_t const> bytes() const
+    {
+        return { reinterpret_cast<std::uint8_t const *>(blocks.data()),
+                 size_in_bytes };
+    }
+
+    std::span<std::uint8_t> bytes()
+    {
+        return { reinterpret_cast<std::uint8_t *>(blocks.data()),
+                 size_in_bytes };
+    }
+
+    std::uint32_t frames() const { return frame_count; }
+
+private:
+    struct alignas(16) block {
+        std::uint8_t bytes[16];
+    };
+
+    std::vector<block> blocks;
+    std::size_t size_in_bytes = 0;
+    std::uint32_t frame_count = 0;
+};
+
+/*
+ * The conversion kernels below copy each sample in and out with memcpy, as a
+ * byte buffer isn't aligned for its sample type, and map unsigned formats to
+ * signed ones with an offset, so every format shares one kernel per type.
+ */
+
+template<typename sample_t>
+void _samples_to_float(std::uint8_t const * bytes, std::size_t count,
+                       float scale, float offset, float * output)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        sample_t sample;
+        std::memcpy(&sample, bytes + i * sizeof(sample_t), sizeof(sample_t));
+        output[i] = (static_cast<float>(sample) - offset) * scale;
+    }
+}
+
+template<typename sample_t>
+void _float_to_samples(float const * samples, std::size_t count,
+                       float scale, float offset, float low, float high,
+                       std::uint8_t * output)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        float const scaled =
+            std::clamp(samples[i] * scale + offset, low, high);
+        auto const sample = static_cast<sample_t>(std::lrint(scaled));
+        std::memcpy(output + i * sizeof(sample_t), &sample, sizeof(sample_t));
+    }
+}
+
+inline bool _native_audio_format(SDL_AudioFormat format)
+{
+    bool const big_endian = SDL_AUDIO_ISBIGENDIAN(format) != 0;
+    return SDL_AUDIO_BITSIZE(format) == 8 or
+           big_endian == (SDL_BYTEORDER != SDL_LIL_ENDIAN);
+}
+
+/**
+ * \brief Convert samples of any native-endian format into floats in [-1, 1]
+ *
+ * \return whether the format is supported
+ */
+inline bool _to_float(std::span<std::uint8_t const> bytes,
+                      SDL_AudioFormat format, std::vector<float> & output)
+{
+    if (not _native_audio_format(format)) { return false; }
+    std::size_t const size = SDL_AUDIO_BITSIZE(format) / 8;
+    std::size_t const count = bytes.size() / size;
+    output.resize(count);
+
+    bool const is_signed = SDL_AUDIO_ISSIGNED(format) != 0;
+    if (SDL_AUDIO_ISFLOAT(format)) {
+        if (size != sizeof(float)) { return false; }
+        _samples_to_float<float>(bytes.data(), count, 1.0f, 0.0f, output.data());
+    }
+    else if (size == 1) {
+        if (is_signed) {
+            _samples_to_float<std::int8_t>(bytes.data(), count, 1.0f / 128,
+                                           0.0f, output.data());
+        }
+        else {
+            _samples_to_float<std::uint8_t>(bytes.data(), count, 1.0f / 128,
+                                            128.0f, output.data());
+        }
+    }
+    else if (size == 2) {
+        if (is_signed) {
+            _samples_to_float<std::int16_t>(bytes.data(), count, 1.0f / 32768,
+                                            0.0f, output.data());
+        }
+        else {
+            _samples_to_float<std::uint16_t>(bytes.data(), count, 1.0f / 32768,
+                                             32768.0f, output.data());
+        }
+    }
+    else if (size == 4 and is_signed) {
+        _samples_to_float<std::int32_t>(bytes.data(), count, 1.0f / 2147483648.0f,
+                                        0.0f, output.data());
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Convert floats in [-1, 1] into samples of a native-endian format
+ *
+ * \return whether the format is supported
+ */
+inline bool _from_float(std::span<float const> samples, SDL_AudioFormat format,
+                        std::uint8_t * output)
+{
+    if (not _native_audio_format(format)) { return false; }
+    std::size_t const size = SDL_AUDIO_BITSIZE(format) / 8;
+    bool const is_signed = SDL_AUDIO_ISSIGNED(format) != 0;
+    float const * data = samples.data();
+    std::size_t const count = samples.size();
+
+    if (SDL_AUDIO_ISFLOAT(format)) {
+        if (size != sizeof(float)) { return false; }
+        std::memcpy(output, data, count * sizeof(float));
+    }
+    else if (size == 1) {
+        if (is_signed) {
+            _float_to_samples<std::int8_t>(data, count, 128.0f, 0.0f,
+                                           -128.0f, 127.0f, output);
+        }
+        else {
+            _float_to_samples<std::uint8_t>(data, count, 128.0f, 128.0f,
+                                            0.0f, 255.0f, output);
+        }
+    }
+    else if (size == 2) {
+        if (is_signed) {
+            _float_to_samples<std::int16_t>(data, count, 32768.0f, 0.0f,
+                                            -32768.0f, 32767.0f, output);
+        }
+        else {
+            _float_to_samples<std::uint16_t>(data, count, 32768.0f, 32768.0f,
+                                             0.0f, 65535.0f, output);
+        }
+    }
+    else if (size == 4 and is_signed) {
+        // the largest float below 2^31, so the clamp can't overflow
+        _float_to_samples<std::int32_t>(data, count, 2147483648.0f, 0.0f,
+                                        -2147483648.0f, 2147483520.0f, output);
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Remix interleaved frames to another number of channels
+ *
+ * Mono is copied to every channel, anything to mono is averaged, and other
+ * layouts keep the channels they share and repeat the rest.
+ */
+inline std::vector<float> _remix(std::vector<float> samples,
+                                 std::size_t from, std::size_t to)
+{
+    if (from == to) { return samples; }
+    std::size_t const frames = samples.size() / from;
+    std::vector<float> remixed(frames * to);
+    for (std::size_t frame = 0; frame < frames; ++frame) {
+        float const * input = samples.data() + frame * from;
+        float * output = remixed.data() + frame * to;
+        if (to == 1) {
+            float sum = 0.0f;
+            for (std::size_t c = 0; c < from; ++c) { sum += input[c]; }
+            output[0] = sum / static_cast<float>(from);
+        }
+        else {
+            for (std::size_t c = 0; c < to; ++c) { output[c] = input[c % from]; }
+        }
+    }
+    return remixed;
+}
+
+/**
+ * \brief The windowed-sinc kernel's taps at each tabulated phase
+ *
+ * Row p holds the weights of the input frames around an output frame that
+ * falls p / sinc_phases of the way past its base frame, normalized so each
+ * row sums to 1.
+ */
+inline std::vector<float> _sinc_table(double cutoff)
+{
+    std::size_t constexpr taps = 2 * limits::sinc_zero_crossings;
+    double constexpr pi = 3.14159265358979323846;
+    double const half_width = static_cast<double>(limits::sinc_zero_crossings);
+
+    std::vector<float> table((limits::sinc_phases + 1) * taps);
+    for (std::size_t phase = 0; phase <= limits::sinc_phases; ++phase) {
+        double const fraction = static_cast<double>(phase) / limits::sinc_phases;
+        float * row = table.data() + phase * taps;
+        double sum = 0.0;
+        for (std::size_t tap = 0; tap < taps; ++tap) {
+            double const distance =
+                static_cast<double>(tap) - (half_width - 1.0) - fraction;
+            double const x = pi * cutoff * distance;
+            double const sinc = x == 0.0 ? 1.0 : std::sin(x) / x;
+            double const t = (distance + half_width) / (2.0 * half_width);
+            double const window = 0.42 - 0.5 * std::cos(2.0 * pi * t) +
+                                  0.08 * std::cos(4.0 * pi * t);
+            double const weight = std::abs(distance) < half_width ?
+                sinc * window : 0.0;
+            row[tap] = static_cast<float>(weight);
+            sum += weight;
+        }
+        for (std::size_t tap = 0; tap < taps; ++tap) {
+            row[tap] = static_cast<float>(row[tap] / sum);
+        }
+    }
+    return table;
+}
+
+/**
+ * \brief Resample interleaved frames to another rate
+ */
+inline std::vector<float> _resample(std::vector<float> samples,
+                                    std::size_t channels, int from, int to,
+                                    resample_quality quality)
+{
+    if (from == to) { return samples; }
+    std::size_t const input_frames = samples.size() / channels;
+    std::size_t const output_frames = static_cast<std::size_t>(
+        static_cast<std::uint64_t>(input_frames) * to / from);
+    std::vector<float> resampled(output_frames * channels);
+    double const step = static_cast<double>(from) / to;
+
+    auto const input = [&](std::ptrdiff_t frame, std::size_t channel) {
+        if (frame < 0 or static_cast<std::size_t>(frame) >= input_frames) {
+            return 0.0f;
+        }
+        return samples[static_cast<std::size_t>(frame) * channels + channel];
+    };
+
+    if (quality == resample_quality::linear) {
+        for (std::size_t frame = 0; frame < output_frames; ++frame) {
+            double const position = frame * step;
+            auto const base = static_cast<std::ptrdiff_t>(position);
+            auto const fraction = static_cast<float>(position - base);
+            for (std::size_t c = 0; c < channels; ++c) {
+                float const a = input(base, c);
+                float const b = base + 1 < static_cast<std::ptrdiff_t>(input_frames) ?
+                    input(base + 1, c) : a;
+                resampled[frame * channels + c] = a + fraction * (b - a);
+            }
+        }
+        return resampled;
+    }
+
+    // lower the cutoff when downsampling so nothing aliases
+    std::vector<float> const table = _sinc_table(std::min(1.0, 1.0 / step));
+    std::size_t constexpr taps = 2 * limits::sinc_zero_crossings;
+    auto constexpr reach =
+        static_cast<std::ptrdiff_t>(limits::sinc_zero_crossings) - 1;
+    for (std::size_t frame = 0; frame < output_frames; ++frame) {
+        double const position = frame * step;
+        auto const base = static_cast<std::ptrdiff_t>(position);
+        auto const phase = static_cast<std::size_t>(
+            std::lround((position - base) * limits::sinc_phases));
+        float const * weights = table.data() + phase * taps;
+        for (std::size_t c = 0; c < channels; ++c) {
+            float sum = 0.0f;
+            for (std::size_t tap = 0; tap < taps; ++tap) {
+                sum += weights[tap] *
+                       input(base - reach + static_cast<std::ptrdiff_t>(tap), c);
+            }
+            resampled[frame * channels + c] = sum;
+        }
+    }
+    return resampled;
+}
+
+/**
+ * \brief Convert samples to a device's exact format, rate and channels
+ *
+ * \param bytes     the samples to convert
+ * \param source    the format, rate and channels of the samples
+ * \param device    the format, rate and channels of the device
+ * \param quality   how to resample if the rates differ
+ * \param volume    a gain to bake into the samples
+ *
+ * \return the converted sound, or a descriptive error message if either
+ *         format isn't supported
+ */
+inline expected<sound, std::string>
+convert_audio(std::span<std::uint8_t const> bytes, SDL_AudioSpec const & source,
+              SDL_AudioSpec const & device,
+              resample_quality quality = resample_quality::linear,
+              float volume = 1.0f)
+{
+    if (source.channels == 0 or device.channels == 0 or
+        source.freq <= 0 or device.freq <= 0) {
+        return unexpected{ "Audio must have channels and a sample rate"s };
+    }
+
+    std::vector<float> samples;
+    if (not _to_float(bytes, source.format, samples)) {
+        return unexpected{ "Audio format "s + std::to_string(source.format) +
+                           " isn't supported"s };
+    }
+    samples.resize(samples.size() / source.channels * source.channels);
+    samples = _remix(std::move(samples), source.channels, device.channels);
+    samples = _resample(std::move(samples), device.channels, source.freq,
+                        device.freq, quality);
+    if (volume != 1.0f) {
+        for (float & sample : samples) { sample *= volume; }
+    }
+
+    std::size_t const sample_size = SDL_AUDIO_BITSIZE(device.format) / 8;
+    sound converted{ samples.size() * sample_size,
+                     static_cast<std::uint32_t>(samples.size() / device.channels) };
+    if (not _from_float(samples, device.format, converted.bytes().data())) {
+        return unexpected{ "Audio format "s + std::to_string(device.format) +
+                           " isn't supported"s };
+    }
+    return converted;
+}
+
+/**
+ * \brief Load a wav file and convert it to a device's exact format
+ *
+ * \param path      the path to the wav file
+ * \param device    the spec the audio device was opened with
+ * \param quality   how to resample if the rates differ
+ * \param volume    a gain to bake into the samples
+ *
+ * \return the converted sound, or a descriptive error message
+ */
+inline expected<sound, std::string>
+load_sound(std::filesystem::path const & path, SDL_AudioSpec const & device,
+           resample_quality quality = resample_quality::linear,
+           float volume = 1.0f)
+{
+    SDL_AudioSpec source;
+    std::uint8_t * buffer = nullptr;
+    std::uint32_t length = 0;
+    SDL_RWops * file = SDL_RWFromFile(path.string().c_str(), "rb");
+    if (not file or
+        not SDL_LoadWAV_RW(file, 1, &source, &buffer, &length)) {
+        return unexpected{ "Couldn't load "s + path.string() + ": "s +
+                           SDL_GetError() };
+    }
+
+    auto result = convert_audio({ buffer, length }, source, device,
+                                quality, volume);
+    SDL_FreeWAV(buffer);
+    if (not result) {
+        return unexpected{ "Couldn't convert "s + path.string() + ": "s +
+                           result.error() };
+    }
+    return result;
+}
+
+/**
+ * \brief Sounds converted for one audio device, found by name
+ */
+class sound_bank {
+public:
+    /**
+     * \brief Find a sound's id by its name
+     */
+    std::optional<std::uint32_t> find(std::string_view name) const
+    {
+        auto const found = ids.find(name);
+        if (found == ids.end()) { return std::nullopt; }
+        return found->second;
+    }
+
+    sound const & operator[](std::uint32_t id) const { return sounds[id]; }
+
+    std::size_t size() const { return sounds.size(); }
+
+    /**
+     * \brief Add a sound to the bank
+     *
+     * \return the sound's id
+     */
+    std::uint32_t add(std::string const & name, sound converted)
+    {
+        auto const id = static_cast<std::uint32_t>(sounds.size());
+        sounds.push_back(std::move(converted));
+        ids.insert_or_assign(name, id);
+        return id;
+    }
+
+private:
+    std::vector<sound> sounds;
+    std::map<std::string, std::uint32_t, std::less<>> ids;
+};
+
+/**
+ * \brief Load every sound in a manifest, converted for an audio device
+ *
+ * Each sound is a wav file, or a table with the file, an optional resampling
+ * quality, and an optional volume:
+ *
+ *      [audio.sounds]
+ *      jump = "sfx/jump.wav"
+ *      explosion = { file = "sfx/explosion.wav", quality = "sinc", volume = 0.8 }
+ *
+ * \param table             the table with the manifest
+ * \param variable_path     the toml path to the manifest
+ * \param device            the spec the audio device was opened with
+ * \param directory         the directory file paths are relative to
+ *
+ * \return the sounds, or a descriptive error message
+ */
+inline expected<sound_bank, std::string>
+load_sounds(toml::table const & table, std::string const & variable_path,
+            SDL_AudioSpec const & device,
+            std::filesystem::path const & directory = {})
+{
+    auto const manifest = subtable_view(table, variable_path);
+    if (not manifest) { return unexpected(manifest.error()); }
+
+    sound_bank bank;
+    for (auto && [key, entry] : **manifest) {
+        std::string const path = variable_path + "."s + key.str();
+        std::optional<std::string> file;
+        resample_quality quality = resample_quality::linear;
+        float volume = 1.0f;
+
+        if (auto const * name = entry.as_string()) {
+            file = name->get();
+        }
+        else if (auto const * settings = entry.as_table()) {
+            file = (*settings)["file"].value<std::string>();
+            std::string const mode =
+                (*settings)["quality"].value_or("linear"s);
+            if (mode == "sinc") {
+                quality = resample_quality::sinc;
+            }
+            else if (mode != "linear") {
+                return unexpected{ path + ".quality must be linear or sinc, "s
+                                   "not "s + mode };
+            }
+            volume = (*settings)["volume"].value_or(1.0f);
+        }
+        if (not file) {
+            return unexpected{ path + " must be a file name or a table with "s
+                               "a file"s };
+        }
+
+        auto loaded = load_sound(directory / *file, device, quality, volume);
+        if (not loaded) { return unexpected{ path + ": "s + loaded.error() }; }
+        bank.add(std::string{ key.str() }, std::move(*loaded));
+    }
+    return bank;
+}
+}
@@ -0,0 +1,311 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/mapped_file.hpp"
+
+// low-level frameworks
+#include <SDL2/SDL.h>
+
+// data types
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <climits>
+
+// data structures
+#include <span>
+#include <optional>
+#include <utility>
+
+// algorithms
+#include <cstring>
+
+// i/o
+#include <filesystem>
+
+namespace raisin::sdl {
+
+using namespace std::string_literals;
+
+/**
+ * \brief Read a little-endian field of a bmp header
+ */
+inline std::uint32_t _read_bmp_field(std::span<std::byte const> bytes,
+                                     std::size_t offset, std::size_t size)
+{
+    std::uint32_t value = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        value |= std::to_integer<std::uint32_t>(bytes[offset + i]) << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * \brief The layout of a bmp's pixels, as far as it can be used without
+ *        SDL's decoder
+ */
+struct _bmp_layout {
+    int width = 0;
+    int height = 0;
+    bool top_down = false;
+    int bits = 0;
+    std::size_t offset = 0;
+    std::size_t stride = 0;
+
+    // SDL_PIXELFORMAT_UNKNOWN if only SDL's decoder can read the pixels
+    std::uint32_t format = SDL_PIXELFORMAT_UNKNOWN;
+};
+
+// whether the cpu reads 16 and 32-bit pixels at any byte offset, as the pixel
+// data of a bmp with a 54 or 138-byte header is only aligned to 2 bytes
+#if defined(__x86_64__) or defined(__i386__) or \
+    defined(_M_X64) or defined(_M_IX86)
+inline bool constexpr _unaligned_pixels = true;
+#else
+inline bool constexpr _unaligned_pixels = false;
+#endif
+
+/**
+ * \brief Whether any 32-bit pixel of a bmp has a nonzero fourth byte
+ */
+inline bool _any_alpha(std::span<std::byte const> bytes,
+                       _bmp_layout const & layout)
+{
+    for (int row = 0; row < layout.height; ++row) {
+        std::size_t const start =
+            layout.offset + static_cast<std::size_t>(row) * layout.stride;
+        for (int column = 0; column < layout.width; ++column) {
+            std::size_t const pixel = static_cast<std::size_t>(column) * 4;
+            if (bytes[start + pixel + 3] != std::byte{ 0 }) { return true; }
+        }
+    }
+    return false;
+}
+
+/**
+ * \brief Validate a bmp's headers and find the layout of its pixels
+ *
+ * \param bytes     the contents of the bmp file
+ * \param name      the name of the file, for error messages
+ *
+ * \return the layout, or a descriptive error message if the file isn't a bmp
+ *         or its pixels don't fit in it
+ */
+inline expected<_bmp_layout, std::string>
+_read_bmp_layout(std::span<std::byte const> bytes, std::string const & name)
+{
+    std::size_t constexpr file_header = 14;
+    std::size_t constexpr info_header = 40;
+    if (bytes.size() < file_header + 4 or
+        bytes[0] != std::byte{ 'B' } or bytes[1] != std::byte{ 'M' }) {
+        return unexpected{ name + " isn't a bmp file"s };
+    }
+
+    _bmp_layout layout;
+    layout.offset = _read_bmp_field(bytes, 10, 4);
+    std::size_t const header_size = _read_bmp_field(bytes, 14, 4);
+    if (header_size < info_header) {
+        // an OS/2 core header, which SDL's decoder reads
+        return layout;
+    }
+    if (bytes.size() < file_header + info_header) {
+        return unexpected{ name + " has a truncated header"s };
+    }
+
+    auto const width =
+        static_cast<std::int32_t>(_read_bmp_field(bytes, 18, 4));
+    auto const height =
+        static_cast<std::int32_t>(_read_bmp_field(bytes, 22, 4));
+    std::uint32_t const planes = _read_bmp_field(bytes, 26, 2);
+    std::uint32_t const bits = _read_bmp_field(bytes, 28, 2);
+    std::uint32_t const compression = _read_bmp_field(bytes, 30, 4);
+    if (width <= 0 or height == 0 or height == INT32_MIN or planes != 1) {
+        return unexpected{ name + " has an invalid size"s };
+    }
+
+    layout.width = width;
+    layout.height = height < 0 ? -height : height;
+    layout.top_down = height < 0;
+    layout.bits = static_cast<int>(bits);
+    layout.stride = (static_cast<std::size_t>(width) * bits + 31) / 32 * 4;
+
+    // compressed rows have no fixed stride, so leave them to SDL's decoder
+    std::uint32_t constexpr rgb = 0, bitfields = 3, alpha_bitfields = 6;
+    if (compression != rgb and compression != bitfields and
+        compression != alpha_bitfields) {
+        return layout;
+    }
+
+    if (layout.offset > bytes.size() or
+        layout.stride * static_cast<std::size_t>(layout.height) >
+            bytes.size() - layout.offset) {
+        return unexpected{ name + "'s pixels don't fit in the file"s };
+    }
+
+    // the masks follow a 40-byte header, or are its next fields when it's
+    // longer, so they're at the same offset either way
+    std::uint32_t red = 0, green = 0, blue = 0, alpha = 0;
+    if (compression == rgb) {
+        if (bits == 16) { red = 0x7c00; green = 0x03e0; blue = 0x001f; }
+        else if (bits == 24 or bits == 32) {
+            red = 0xff0000; green = 0x00ff00; blue = 0x0000ff;
+        }
+        else { return layout; }
+
+        // like SDL's decoder, the fourth byte of 32-bit pixels is alpha
+        // unless every one of them is zero, when the image is opaque
+        if (bits == 32 and _any_alpha(bytes, layout)) { alpha = 0xff000000; }
+    }
+    else {
+        std::size_t constexpr masks = file_header + info_header;
+        bool const has_alpha = compression == alpha_bitfields or
+                               header_size >= info_header + 16;
+        if (bytes.size() < masks + (has_alpha ? 16 : 12) or
+            (bits != 16 and bits != 32)) {
+            return layout;
+        }
+        red = _read_bmp_field(bytes, masks, 4);
+        green = _read_bmp_field(bytes, masks + 4, 4);
+        blue = _read_bmp_field(bytes, masks + 8, 4);
+        if (has_alpha) { alpha = _read_bmp_field(bytes, masks + 12, 4); }
+    }
+
+    // the masks describe little-endian pixels
+    if (SDL_BYTEORDER == SDL_LIL_ENDIAN) {
+        layout.format = SDL_MasksToPixelEnum(layout.bits,
+                                             red, green, blue, alpha);
+    }
+    return layout;
+}
+
+/**
+ * \brief A surface loaded from a bmp file, which may point straight into the
+ *        memory-mapped file
+ *
+ * \note When mapped() is true the surface's pixels are the file's read-only
+ *       pages. Reading, blitting from and making textures of the surface is
+ *       fine; writing to its pixels is not.
+ */
+class bmp_surface {
+public:
+    bmp_surface(bmp_surface && other) noexcept
+        : file{ std::move(other.file) },
+          surface{ std::exchange(other.surface, nullptr) }
+    {
+    }
+
+    bmp_surface & operator=(bmp_surface && other) noexcept
+    {
+        if (this != &other) {
+            if (surface) { SDL_FreeSurface(surface); }
+            file = std::move(other.file);
+            surface = std::exchange(other.surface, nullptr);
+        }
+        return *this;
+    }
+
+    bmp_surface(bmp_surface const &) = delete;
+    bmp_surface & operator=(bmp_surface const &) = delete;
+
+    ~bmp_surface()
+    {
+        // the surface goes before the mapping its pixels may be in
+        if (surface) { SDL_FreeSurface(surface); }
+    }
+
+    SDL_Surface * get() const { return surface; }
+
+    /**
+     * \brief Whether the surface's pixels are the mapped file's, not a copy
+     */
+    bool mapped() const { return file.has_value(); }
+
+private:
+    friend expected<bmp_surface, std::string>
+    load_bmp(std::filesystem::path const & path);
+
+    bmp_surface(std::optional<mapped_file> file, SDL_Surface * surface)
+        : file{ std::move(file) }, surface{ surface }
+    {
+    }
+
+    std::optional<mapped_file> file;
+    SDL_Surface * surface;
+};
+
+/**
+ * \brief Load a bmp file into a surface without reading it into memory
+ *
+ * The file is memory-mapped. When its rows are stored top-down in a format SDL
+ * can use directly, the surface wraps the mapped pixels, so loading costs only
+ * the page faults of touching them. Bottom-up rows of such a format are
+ * flipped into a new surface in one pass. Anything else, like palettes or
+ * run-length encoding, is decoded by SDL from the mapping.
+ *
+ * Uncompressed 32-bit pixels are scanned once first, since like SDL_LoadBMP
+ * their fourth byte is taken as alpha unless it's zero in every pixel.
+ *
+ * \param path  the path to the bmp file
+ *
+ * \return the surface, or a descriptive error message
+ */
+inline expected<bmp_surface, std::string>
+load_bmp(std::filesystem::path const & path)
+{
+    auto file = mapped_file::open(path.string());
+    if (not file) { return unexpected(file.error()); }
+
+    auto const bytes = file->bytes();
+    auto const layout = _read_bmp_layout(bytes, path.string());
+    if (not layout) { return unexpected(layout.error()); }
+
+    if (layout->format == SDL_PIXELFORMAT_UNKNOWN) {
+        if (bytes.size() > INT_MAX) {
+            return unexpected{ path.string() + " is too big to decode"s };
+        }
+        SDL_Surface * surface = SDL_LoadBMP_RW(
+            SDL_RWFromConstMem(bytes.data(), static_cast<int>(bytes.size())),
+            1);
+        if (not surface) {
+            return unexpected{ "Couldn't load "s + path.string() + ": "s +
+                               SDL_GetError() };
+        }
+        return bmp_surface{ std::nullopt, surface };
+    }
+
+    std::byte const * pixels = bytes.data() + layout->offset;
+    std::size_t const pixel_size = static_cast<std::size_t>(layout->bits) / 8;
+    bool const aligned = _unaligned_pixels or
+        reinterpret_cast<std::uintptr_t>(pixels) % pixel_size == 0;
+    if (layout->top_down and aligned and layout->stride <= INT_MAX) {
+        // SDL only reads the pixels through a surface it doesn't own
+        SDL_Surface * surface = SDL_CreateRGBSurfaceWithFormatFrom(
+            const_cast<std::byte *>(pixels), layout->width, layout->height,
+            layout->bits, static_cast<int>(layout->stride), layout->format);
+        if (not surface) {
+            return unexpected{ "Couldn't wrap "s + path.string() + ": "s +
+                               SDL_GetError() };
+        }
+        return bmp_surface{ std::move(*file), surface };
+    }
+
+    SDL_Surface * surface = SDL_CreateRGBSurfaceWithFormat(
+        0, layout->width, layout->height, layout->bits, layout->format);
+    if (not surface) {
+        return unexpected{ "Couldn't make a surface for "s + path.string() +
+                           ": "s + SDL_GetError() };
+    }
+
+    std::size_t const row_size =
+        static_cast<std::size_t>(layout->width) * pixel_size;
+    auto * destination = static_cast<std::byte *>(surface->pixels);
+    for (int row = 0; row < layout->height; ++row) {
+        int const source_row =
+            layout->top_down ? row : layout->height - 1 - row;
+        std::memcpy(
+            destination + static_cast<std::size_t>(row) * surface->pitch,
+            pixels + static_cast<std::size_t>(source_row) * layout->stride,
+            row_size);
+    }
+    return bmp_surface{ std::nullopt, surface };
+}
+}
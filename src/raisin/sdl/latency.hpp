@@ -0,0 +1,315 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+
+// low-level frameworks
+#include <SDL2/SDL.h>
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+// data structures
+#include <map>
+#include <array>
+#include <memory>
+#include <optional>
+
+// algorithms
+#include <algorithm>
+
+// i/o
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin::limits {
+// latencies are counted in one-millisecond bins up to this, and above it in
+// one overflow bin
+std::size_t constexpr max_latency_ms = 250;
+
+// the most input events tracked in one frame; the rest are dropped and counted
+std::size_t constexpr max_frame_inputs = 256;
+}
+
+namespace raisin::sdl {
+
+using namespace std::string_literals;
+
+/**
+ * \brief A distribution of latencies in milliseconds
+ */
+class latency_histogram {
+public:
+    void add(std::uint32_t latency)
+    {
+        ++bins[std::min<std::size_t>(latency, limits::max_latency_ms + 1)];
+        ++total;
+        sum += latency;
+        longest = std::max(longest, latency);
+    }
+
+    std::size_t count() const { return total; }
+    std::uint32_t max() const { return longest; }
+
+    double mean() const
+    {
+        return total == 0 ? 0.0 : static_cast<double>(sum) / total;
+    }
+
+    /**
+     * \brief The latency that a fraction of samples are at or below
+     *
+     * \param fraction  the fraction of samples, from 0 to 1
+     *
+     * \return the latency, or max_latency_ms + 1 if it's in the overflow bin
+     */
+    std::uint32_t percentile(double fraction) const
+    {
+        auto const rank = static_cast<std::size_t>(
+            std::max(1.0, fraction * static_cast<double>(total) + 0.5));
+        std::size_t seen = 0;
+        for (std::size_t latency = 0; latency < bins.size(); ++latency) {
+            seen += bins[latency];
+            if (seen >= rank) { return static_cast<std::uint32_t>(latency); }
+        }
+        return 0;
+    }
+
+private:
+    std::array<std::size_t, limits::max_latency_ms + 2> bins{};
+    std::size_t total = 0;
+    std::uint64_t sum = 0;
+    std::uint32_t longest = 0;
+};
+
+/**
+ * \brief The settings of a latency tracker
+ */
+struct latency_settings {
+    // a name for the frame loop's configuration, like "vsync-double-buffered"
+    std::string configuration = "default"s;
+
+    // a file to write every measured latency to, as csv
+    std::optional<std::filesystem::path> trace;
+};
+
+/**
+ * \brief Measures the time from input events to the present that shows them
+ *
+ * Mark each input event as it's consumed, and the frame it's consumed in is
+ * measured up to the moment SDL_RenderPresent returns. Latencies are
+ * collected per frame-loop configuration, so configurations can be compared
+ * in one run:
+ *
+ *      while (SDL_PollEvent(&event)) {
+ *          tracker.consume(event);
+ *          handle(event);
+ *      }
+ *      draw();
+ *      tracker.present(renderer);
+ *      ...
+ *      tracker.report(std::cout);
+ *
+ * \note SDL timestamps are in milliseconds, so latencies are too.
+ */
+class latency_tracker {
+public:
+    explicit latency_tracker(latency_settings const & settings = {})
+        : active{ &histograms[settings.configuration] },
+          configuration_name{ settings.configuration }
+    {
+        if (settings.trace) {
+            trace = std::make_unique<std::ofstream>(*settings.trace);
+            *trace << "frame,configuration,event,timestamp,present,latency\n";
+        }
+    }
+
+    /**
+     * \brief Whether an event is input whose latency is measured
+     */
+    static bool is_input(SDL_Event const & event)
+    {
+        switch (event.type) {
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+        case SDL_TEXTINPUT:
+        case SDL_MOUSEMOTION:
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+        case SDL_MOUSEWHEEL:
+        case SDL_CONTROLLERAXISMOTION:
+        case SDL_CONTROLLERBUTTONDOWN:
+        case SDL_CONTROLLERBUTTONUP:
+        case SDL_FINGERDOWN:
+        case SDL_FINGERUP:
+        case SDL_FINGERMOTION:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * \brief Mark an event as consumed by the current frame
+     *
+     * \return whether the event is input that will be measured
+     */
+    bool consume(SDL_Event const & event)
+    {
+        if (not is_input(event)) { return false; }
+        if (inputs == pending.size()) {
+            ++dropped_count;
+            return false;
+        }
+        pending[inputs++] = { event.type, event.common.timestamp };
+        return true;
+    }
+
+    /**
+     * \brief Measure the latency of every input consumed this frame
+     *
+     * \param now   the time the frame was presented, in milliseconds, as from
+     *              SDL_GetTicks right after SDL_RenderPresent returns
+     */
+    void presented(std::uint32_t now = SDL_GetTicks())
+    {
+        for (std::size_t i = 0; i < inputs; ++i) {
+            // unsigned subtraction handles the timer wrapping
+            std::uint32_t const latency = now - pending[i].timestamp;
+            active->add(latency);
+            if (trace) {
+                *trace << frame << ',' << configuration_name << ','
+                       << pending[i].type << ',' << pending[i].timestamp << ','
+                       << now << ',' << latency << '\n';
+            }
+        }
+        inputs = 0;
+        ++frame;
+    }
+
+    /**
+     * \brief Present a frame and measure the latency of its inputs
+     */
+    void present(SDL_Renderer * renderer)
+    {
+        SDL_RenderPresent(renderer);
+        presented(SDL_GetTicks());
+    }
+
+    /**
+     * \brief Collect latencies under another frame-loop configuration from
+     *        the next frame on
+     */
+    void configure(std::string const & configuration)
+    {
+        active = &histograms[configuration];
+        configuration_name = configuration;
+    }
+
+    /**
+     * \brief The latencies of each configuration
+     */
+    std::map<std::string, latency_histogram, std::less<>> const &
+    distributions() const
+    {
+        return histograms;
+    }
+
+    /**
+     * \brief The number of inputs that weren't measured because a frame
+     *        consumed more than max_frame_inputs
+     */
+    std::size_t dropped() const { return dropped_count; }
+
+    /**
+     * \brief Write a summary of each configuration's latencies
+     */
+    void report(std::ostream & output) const
+    {
+        for (auto const & [name, histogram] : histograms) {
+            if (histogram.count() == 0) { continue; }
+            output << name << ": " << histogram.count() << " inputs, mean "
+                   << histogram.mean() << " ms, p50 "
+                   << histogram.percentile(0.5) << " ms, p90 "
+                   << histogram.percentile(0.9) << " ms, p99 "
+                   << histogram.percentile(0.99) << " ms, max "
+                   << histogram.max() << " ms\n";
+        }
+        if (dropped_count > 0) {
+            output << dropped_count << " inputs weren't measured\n";
+        }
+    }
+
+private:
+    struct input {
+        std::uint32_t type;
+        std::uint32_t timestamp;
+    };
+
+    std::map<std::string, latency_histogram, std::less<>> histograms;
+    latency_histogram * active;
+    std::string configuration_name;
+    std::array<input, limits::max_frame_inputs> pending;
+    std::size_t inputs = 0;
+    std::size_t dropped_count = 0;
+    std::uint64_t frame = 0;
+    std::unique_ptr<std::ofstream> trace;
+};
+
+/**
+ * \brief Load the settings of a latency tracker
+ *
+ * toml parameters:
+ *
+ *  string configuration    OPTIONAL    a name for the frame loop's
+ *                                      configuration, defaults to "default"
+ *  string trace            OPTIONAL    a csv file to write every latency to
+ *
+ * \param table             the table with the settings
+ * \param variable_path     the toml path to the settings
+ *
+ * \return the settings, or a descriptive error message
+ */
+inline expected<latency_settings, std::string>
+load_latency(toml::table const & table, std::string const & variable_path)
+{
+    auto const view = subtable_view(table, variable_path);
+    if (not view) { return unexpected(view.error()); }
+
+    latency_settings settings;
+    settings.configuration = (**view)["configuration"].value_or(settings.configuration);
+    if (auto const trace = (**view)["trace"].value<std::string>()) {
+        settings.trace = *trace;
+    }
+    return settings;
+}
+
+/**
+ * \brief Load the settings of a latency tracker into an output
+ *
+ * \param variable_path     the toml path to the settings
+ * \param output            where to store the settings
+ *
+ * \return a function that loads the settings from a table, and returns the
+ *         table or a descriptive error message
+ */
+inline auto load_latency(std::string const & variable_path,
+                         latency_settings & output)
+{
+    return [&variable_path, &output](toml::table const & table)
+        -> expected<toml::table, std::string>
+    {
+        auto result = load_latency(table, variable_path);
+        if (not result) { return unexpected(result.error()); }
+        output = std::move(*result);
+        return table;
+    };
+}
+}
@@ -0,0 +1,522 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+
+// frameworks
+#include <SDL2/SDL.h>
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// data structures
+#include <span>
+#include <array>
+#include <vector>
+#include <memory>
+#include <optional>
+
+// algorithms
+#include <algorithm>
+#include <bit>
+
+// concurrency
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// i/o
+#include <filesystem>
+#include <fstream>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin::sdl {
+
+using namespace std::string_literals;
+
+/**
+ * \brief A single-producer, single-consumer ring of bytes
+ */
+class byte_ring {
+public:
+    explicit byte_ring(std::size_t capacity)
+        : bytes{ std::make_unique<std::uint8_t[]>(std::bit_ceil(capacity)) },
+          mask{ std::bit_ceil(capacity) - 1 }
+    {
+    }
+
+    /**
+     * \brief Write as many bytes as fit
+     *
+     * \return the number of bytes written
+     */
+    std::size_t write(std::span<std::uint8_t const> input) noexcept
+    {
+        std::size_t const tail = tail_index.load(std::memory_order_relaxed);
+        std::size_t const head = head_index.load(std::memory_order_acquire);
+        std::size_t const count = std::min(input.size(), mask + 1 - (tail - head));
+        std::size_t const first = std::min(count, mask + 1 - (tail & mask));
+        std::memcpy(bytes.get() + (tail & mask), input.data(), first);
+        std::memcpy(bytes.get(), input.data() + first, count - first);
+        tail_index.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * \brief Read as many bytes as are available
+     *
+     * \return the number of bytes read
+     */
+    std::size_t read(std::span<std::uint8_t> output) noexcept
+    {
+        std::size_t const head = head_index.load(std::memory_order_relaxed);
+        std::size_t const tail = tail_index.load(std::memory_order_acquire);
+        std::size_t const count = std::min(output.size(), tail - head);
+        std::size_t const first = std::min(count, mask + 1 - (head & mask));
+        std::memcpy(output.data(), bytes.get() + (head & mask), first);
+        std::memcpy(output.data() + first, bytes.get(), count - first);
+        head_index.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return tail_index.load(std::memory_order_acquire) -
+               head_index.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const noexcept { return mask + 1; }
+
+private:
+    alignas(64) std::atomic<std::size_t> head_index{ 0 };
+    alignas(64) std::atomic<std::size_t> tail_index{ 0 };
+    std::unique_ptr<std::uint8_t[]> bytes;
+    std::size_t mask;
+};
+
+/**
+ * \brief The settings of a streamed music track
+ */
+struct music_settings {
+    std::filesystem::path file;
+
+    // the seconds of audio to keep decoded ahead of the device
+    float prefetch = 0.5f;
+
+    // the frames read from the file at a time
+    std::uint32_t chunk_frames = 4096;
+
+    bool loop = true;
+
+    // the layout of raw pcm files, which have no header; wav files describe
+    // their own layout
+    std::optional<SDL_AudioSpec> raw;
+};
+
+/**
+ * \brief Where the samples are in a pcm file, and their layout
+ */
+struct _pcm_layout {
+    SDL_AudioSpec spec{};
+    std::streamoff offset = 0;
+    std::uint64_t size = 0;
+};
+
+inline std::uint32_t _read_le(std::uint8_t const * bytes, std::size_t size)
+{
+    std::uint32_t value = 0;
+    for (std::size_t i = size; i-- > 0; ) { value = value << 8 | bytes[i]; }
+    return value;
+}
+
+/**
+ * \brief Find the samples in a wav file by walking its chunks
+ */
+inline expected<_pcm_layout, std::string>
+_read_wav_layout(std::ifstream & file, std::string const & name)
+{
+    std::array<std::uint8_t, 12> riff;
+    if (not file.read(reinterpret_cast<char *>(riff.data()), riff.size()) or
+        std::memcmp(riff.data(), "RIFF", 4) != 0 or
+        std::memcmp(riff.data() + 8, "WAVE", 4) != 0) {
+        return unexpected{ name + " isn't a wav file"s };
+    }
+
+    _pcm_layout layout;
+    bool has_format = false;
+    std::array<std::uint8_t, 8> header;
+    while (file.read(reinterpret_cast<char *>(header.data()), header.size())) {
+        std::uint32_t const size = _read_le(header.data() + 4, 4);
+        if (std::memcmp(header.data(), "data", 4) == 0) {
+            if (not has_format) { break; }
+            layout.offset = file.tellg();
+            layout.size = size;
+            return layout;
+        }
+        if (std::memcmp(header.data(), "fmt ", 4) == 0 and size >= 16) {
+            std::array<std::uint8_t, 16> format;
+            file.read(reinterpret_cast<char *>(format.data()), format.size());
+            std::uint32_t const encoding = _read_le(format.data(), 2);
+            std::uint32_t const bits = _read_le(format.data() + 14, 2);
+            layout.spec.channels = static_cast<std::uint8_t>(_read_le(format.data() + 2, 2));
+            layout.spec.freq = static_cast<int>(_read_le(format.data() + 4, 4));
+            if (encoding == 1 and bits == 8) { layout.spec.format = AUDIO_U8; }
+            else if (encoding == 1 and bits == 16) { layout.spec.format = AUDIO_S16LSB; }
+            else if (encoding == 1 and bits == 32) { layout.spec.format = AUDIO_S32LSB; }
+            else if (encoding == 3 and bits == 32) { layout.spec.format = AUDIO_F32LSB; }
+            else {
+                return unexpected{ name + " has an unsupported sample format"s };
+            }
+            has_format = true;
+            file.seekg(size - format.size() + (size & 1), std::ios::cur);
+        }
+        else {
+            // chunks are padded to even sizes
+            file.seekg(size + (size & 1), std::ios::cur);
+        }
+    }
+    return unexpected{ name + " has no format or no samples"s };
+}
+
+/**
+ * \brief Music streamed from disk to an audio device
+ *
+ * A background thread reads the file a chunk at a time, converts it to the
+ * device's format with an SDL_AudioStream, and keeps a prefetch window of
+ * converted audio in a lock-free ring. The audio callback only copies out of
+ * the ring, so a stream holds a few hundred kilobytes however long the track
+ * is:
+ *
+ *      void callback(void * music, Uint8 * stream, int length)
+ *      {
+ *          static_cast<raisin::sdl::music_stream *>(music)->read(
+ *              { stream, static_cast<std::size_t>(length) });
+ *      }
+ *
+ * \note Underruns, when the ring runs dry before the track ends, are filled
+ *       with silence and counted.
+ */
+class music_stream {
+public:
+    /**
+     * \brief Open a track and start prefetching it
+     *
+     * \param settings  the track to stream
+     * \param device    the spec the audio device was opened with
+     * \param directory the directory the file is relative to
+     *
+     * \return the stream, or a descriptive error message
+     */
+    static expected<std::unique_ptr<music_stream>, std::string>
+    open(music_settings const & settings, SDL_AudioSpec const & device,
+         std::filesystem::path const & directory = {})
+    {
+        std::filesystem::path const path = directory / settings.file;
+        std::ifstream file{ path, std::ios::binary };
+        if (not file) {
+            return unexpected{ "Couldn't open "s + path.string() };
+        }
+
+        _pcm_layout layout;
+        if (settings.raw) {
+            file.seekg(0, std::ios::end);
+            layout.spec = *settings.raw;
+            layout.size = static_cast<std::uint64_t>(file.tellg());
+            file.seekg(0);
+        }
+        else {
+            auto result = _read_wav_layout(file, path.string());
+            if (not result) { return unexpected(result.error()); }
+            layout = *result;
+        }
+
+        std::size_t const frame_size =
+            SDL_AUDIO_BITSIZE(layout.spec.format) / 8 * layout.spec.channels;
+        if (frame_size == 0 or layout.spec.freq <= 0) {
+            return unexpected{ path.string() + " has no channels or no "s
+                               "sample rate"s };
+        }
+        layout.size -= layout.size % frame_size;
+
+        SDL_AudioStream * converter = nullptr;
+        if (layout.spec.format != device.format or
+            layout.spec.channels != device.channels or
+            layout.spec.freq != device.freq) {
+            converter = SDL_NewAudioStream(
+                layout.spec.format, layout.spec.channels, layout.spec.freq,
+                device.format, device.channels, device.freq);
+            if (not converter) {
+                return unexpected{ "Couldn't convert "s + path.string() +
+                                   ": "s + SDL_GetError() };
+            }
+        }
+        return std::unique_ptr<music_stream>{ new music_stream{
+            settings, device, std::move(file), layout, frame_size, converter } };
+    }
+
+    music_stream(music_stream const &) = delete;
+    music_stream & operator=(music_stream const &) = delete;
+
+    ~music_stream()
+    {
+        running.store(false, std::memory_order_release);
+        worker.join();
+        if (converter) { SDL_FreeAudioStream(converter); }
+    }
+
+    /**
+     * \brief Copy the next audio into a device buffer, from the callback
+     *
+     * \return whether the track is still playing
+     */
+    bool read(std::span<std::uint8_t> output) noexcept
+    {
+        // the ring's capacity is a power of two, so it can hold part of a
+        // frame; leave that in the ring so playback stays frame-aligned
+        std::size_t const available = ring.size();
+        std::size_t const whole = std::min(
+            output.size(), available - available % device_frame);
+        std::size_t const count = ring.read(output.first(whole));
+        if (count == output.size()) { return true; }
+
+        std::memset(output.data() + count, silence, output.size() - count);
+        if (ended.load(std::memory_order_acquire) and ring.size() == 0) {
+            return false;
+        }
+        underrun_count.fetch_add(1, std::memory_order_relaxed);
+        underrun_bytes.fetch_add(output.size() - count, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * \brief The number of times the device asked for audio that wasn't
+     *        decoded yet
+     */
+    std::size_t underruns() const
+    {
+        return underrun_count.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief The bytes of silence played because of underruns
+     */
+    std::size_t underrun_size() const
+    {
+        return underrun_bytes.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief The seconds of audio decoded ahead of the device
+     */
+    float buffered() const
+    {
+        return static_cast<float>(ring.size()) / static_cast<float>(device_rate);
+    }
+
+    /**
+     * \brief Whether the whole track has been played
+     */
+    bool finished() const
+    {
+        return ended.load(std::memory_order_acquire) and ring.size() == 0;
+    }
+
+private:
+    music_stream(music_settings const & settings, SDL_AudioSpec const & device,
+                 std::ifstream file, _pcm_layout const & layout,
+                 std::size_t frame_size, SDL_AudioStream * converter)
+        : ring{ static_cast<std::size_t>(
+                    std::max(settings.prefetch, 0.01f) * _byte_rate(device)) },
+          file{ std::move(file) }, layout{ layout },
+          chunk_size{ std::max<std::size_t>(settings.chunk_frames, 1) * frame_size },
+          device_rate{ _byte_rate(device) },
+          device_frame{ std::max<std::size_t>(
+              device.channels * (SDL_AUDIO_BITSIZE(device.format) / 8), 1) },
+          silence{ device.silence },
+          loop{ settings.loop }, converter{ converter },
+          worker{ [this] { run(); } }
+    {
+    }
+
+    static std::size_t _byte_rate(SDL_AudioSpec const & device)
+    {
+        return static_cast<std::size_t>(device.freq) * device.channels *
+               (SDL_AUDIO_BITSIZE(device.format) / 8);
+    }
+
+    byte_ring ring;
+    std::ifstream file;
+    _pcm_layout layout;
+    std::size_t chunk_size;
+    std::size_t device_rate;
+    std::size_t device_frame;
+    std::uint8_t silence;
+    bool loop;
+    SDL_AudioStream * converter;
+
+    std::atomic<std::size_t> underrun_count{ 0 };
+    std::atomic<std::size_t> underrun_bytes{ 0 };
+    std::atomic<bool> ended{ false };
+    std::atomic<bool> running{ true };
+    std::thread worker;
+
+    /**
+     * \brief Read and convert the next chunk of the file
+     *
+     * \return the converted audio, which is empty at the end of the track
+     */
+    std::span<std::uint8_t const>
+    next_chunk(std::vector<std::uint8_t> & chunk,
+               std::vector<std::uint8_t> & converted, std::uint64_t & remaining)
+    {
+        while (true) {
+            if (remaining == 0 and loop and layout.size > 0) {
+                file.clear();
+                file.seekg(layout.offset);
+                remaining = layout.size;
+            }
+            std::size_t const size = static_cast<std::size_t>(
+                std::min<std::uint64_t>(chunk.size(), remaining));
+            if (size > 0) {
+                file.read(reinterpret_cast<char *>(chunk.data()), size);
+                std::size_t const got = static_cast<std::size_t>(file.gcount());
+                remaining = got == size ? remaining - size : 0;
+                // stop looping a file that can't be read
+                if (got == 0) { loop = false; }
+                if (not converter) { return { chunk.data(), got }; }
+                SDL_AudioStreamPut(converter, chunk.data(), static_cast<int>(got));
+            }
+            else if (converter) {
+                SDL_AudioStreamFlush(converter);
+            }
+
+            if (not converter) { return {}; }
+            converted.resize(static_cast<std::size_t>(
+                std::max(SDL_AudioStreamAvailable(converter), 0)));
+            int const got = SDL_AudioStreamGet(converter, converted.data(),
+                                               static_cast<int>(converted.size()));
+            if (got > 0) { return { converted.data(), static_cast<std::size_t>(got) }; }
+            if (size == 0) { return {}; }
+        }
+    }
+
+    void run()
+    {
+        std::vector<std::uint8_t> chunk(chunk_size);
+        std::vector<std::uint8_t> converted;
+        std::uint64_t remaining = layout.size;
+        std::span<std::uint8_t const> pending;
+
+        // wait about a quarter of the window before checking for space again
+        auto const pause = std::chrono::microseconds{
+            static_cast<std::int64_t>(ring.capacity() * 250'000 /
+                                      std::max<std::size_t>(device_rate, 1)) };
+
+        while (running.load(std::memory_order_acquire)) {
+            if (pending.empty()) {
+                pending = next_chunk(chunk, converted, remaining);
+                if (pending.empty()) {
+                    ended.store(true, std::memory_order_release);
+                    return;
+                }
+            }
+            pending = pending.subspan(ring.write(pending));
+            if (not pending.empty()) { std::this_thread::sleep_for(pause); }
+        }
+    }
+};
+
+/**
+ * \brief Load the settings of a streamed music track
+ *
+ * Only the file is required. Raw pcm files, which have no header, give their
+ * sample format (u8, s16, s32 or f32), rate and channels:
+ *
+ *      [music.title]
+ *      file = "music/title.wav"
+ *      prefetch = 0.5          # seconds
+ *      chunk-frames = 4096
+ *      loop = true
+ *
+ *      [music.ambience]
+ *      file = "music/ambience.pcm"
+ *      raw = { format = "s16", rate = 44100, channels = 2 }
+ *
+ * \param table             the table with the settings
+ * \param variable_path     the toml path to the settings
+ *
+ * \return the settings, or a descriptive error message
+ */
+inline expected<music_settings, std::string>
+load_music(toml::table const & table, std::string const & variable_path)
+{
+    auto const view = subtable_view(table, variable_path);
+    if (not view) { return unexpected(view.error()); }
+    toml::table const & music = **view;
+
+    music_settings settings;
+    auto const file = music["file"].value<std::string>();
+    if (not file) {
+        return unexpected{ _missing_variable(variable_path + ".file"s) };
+    }
+    settings.file = *file;
+    settings.prefetch = music["prefetch"].value_or(settings.prefetch);
+    settings.chunk_frames = music["chunk-frames"].value_or(settings.chunk_frames);
+    settings.loop = music["loop"].value_or(settings.loop);
+    if (not (settings.prefetch > 0.0f) or settings.chunk_frames == 0) {
+        return unexpected{ variable_path + " must have a positive prefetch "s
+                           "and chunk-frames"s };
+    }
+
+    if (auto const * raw = music["raw"].as_table()) {
+        static std::array<std::pair<std::string_view, SDL_AudioFormat>, 4>
+        const formats{ { { "u8", AUDIO_U8 }, { "s16", AUDIO_S16LSB },
+                         { "s32", AUDIO_S32LSB }, { "f32", AUDIO_F32LSB } } };
+        std::string const name = (*raw)["format"].value_or(""s);
+        auto const format = std::find_if(formats.begin(), formats.end(),
+            [&name](auto const & entry) { return entry.first == name; });
+        auto const rate = (*raw)["rate"].value<int>();
+        auto const channels = (*raw)["channels"].value<int>();
+        if (format == formats.end() or not rate or not channels or
+            *channels < 1 or *channels > 8) {
+            return unexpected{ variable_path + ".raw must have a format of "s
+                               "u8, s16, s32 or f32, a rate, and 1 to 8 "s
+                               "channels"s };
+        }
+        SDL_AudioSpec spec{};
+        spec.format = format->second;
+        spec.freq = *rate;
+        spec.channels = static_cast<std::uint8_t>(*channels);
+        settings.raw = spec;
+    }
+    return settings;
+}
+
+/**
+ * \brief Load the settings of a streamed music track into an output
+ *
+ * \param variable_path     the toml path to the settings
+ * \param output            where to store the settings
+ *
+ * \return a function that loads the settings from a table, and returns the
+ *         table or a descriptive error message
+ */
+inline auto load_music(std::string const & variable_path,
+                       music_settings & output)
+{
+    return [&variable_path, &output](toml::table const & table)
+        -> expected<toml::table, std::string>
+    {
+        auto result = load_music(table, variable_path);
+        if (not result) { return unexpected(result.error()); }
+        output = std::move(*result);
+        return table;
+    };
+}
+}
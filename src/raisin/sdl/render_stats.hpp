@@ -0,0 +1,306 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+
+// low-level frameworks
+#include <SDL2/SDL.h>
+
+// data types
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// data structures
+#include <optional>
+
+// algorithms
+#include <type_traits>
+
+// i/o
+#include <ostream>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin::sdl {
+
+using namespace std::string_literals;
+
+/**
+ * \brief What a frame asked of the renderer
+ */
+struct render_stats {
+    // SDL_RenderCopy, SDL_RenderCopyF, SDL_RenderCopyEx(F) and
+    // SDL_RenderGeometry calls
+    std::uint32_t draw_calls = 0;
+
+    // draws using a different texture than the draw before them
+    std::uint32_t texture_switches = 0;
+
+    // draws using a different blend mode than the draw before them
+    std::uint32_t blend_changes = 0;
+
+    // bytes passed to SDL_UpdateTexture
+    std::size_t upload_bytes = 0;
+};
+
+/**
+ * \brief Limits above which a frame's statistics are logged, with no limit
+ *        where one isn't set
+ */
+struct render_thresholds {
+    std::optional<std::uint32_t> draw_calls;
+    std::optional<std::uint32_t> texture_switches;
+    std::optional<std::uint32_t> blend_changes;
+    std::optional<std::size_t> upload_bytes;
+};
+
+/**
+ * \brief A renderer that counts the draw calls, state changes and texture
+ *        uploads of each frame
+ *
+ * Draw through the facade's functions instead of the SDL ones, and end each
+ * frame with present(). The renderer is borrowed, not owned, so it can be the
+ * one made by load_renderer:
+ *
+ *      instrumented_renderer stats{ renderer, thresholds, &std::clog };
+ *      stats.copy(sheet, &source, &destination);
+ *      stats.present();
+ *      if (stats.last().texture_switches > budget) { ... }
+ *
+ * A texture switch or blend change is counted when a draw's texture or blend
+ * mode differs from the previous draw's, since that's what breaks a batch,
+ * however many times the state was set in between.
+ */
+class instrumented_renderer {
+public:
+    /**
+     * \param renderer      to draw with
+     * \param thresholds    above which a frame is logged
+     * \param log           where to log frames over a threshold, or nullptr
+     *                      to not log them
+     */
+    explicit instrumented_renderer(SDL_Renderer * renderer,
+                                   render_thresholds const & thresholds = {},
+                                   std::ostream * log = nullptr)
+        : renderer{ renderer }, thresholds{ thresholds }, log{ log }
+    {
+    }
+
+    SDL_Renderer * get() const { return renderer; }
+
+    /**
+     * \brief The statistics of the frame being drawn
+     */
+    render_stats const & current() const { return frame; }
+
+    /**
+     * \brief The statistics of the last presented frame
+     */
+    render_stats const & last() const { return previous; }
+
+    /**
+     * \brief The number of frames presented
+     */
+    std::uint64_t frames() const { return frame_count; }
+
+    int copy(SDL_Texture * texture,
+             SDL_Rect const * source, SDL_Rect const * destination)
+    {
+        draw(texture);
+        return SDL_RenderCopy(renderer, texture, source, destination);
+    }
+
+    int copy(SDL_Texture * texture,
+             SDL_Rect const * source, SDL_FRect const * destination)
+    {
+        draw(texture);
+        return SDL_RenderCopyF(renderer, texture, source, destination);
+    }
+
+    int copy(SDL_Texture * texture,
+             SDL_Rect const * source, SDL_Rect const * destination,
+             double angle, SDL_Point const * center, SDL_RendererFlip flip)
+    {
+        draw(texture);
+        return SDL_RenderCopyEx(renderer, texture, source, destination,
+                                angle, center, flip);
+    }
+
+    int copy(SDL_Texture * texture,
+             SDL_Rect const * source, SDL_FRect const * destination,
+             double angle, SDL_FPoint const * center, SDL_RendererFlip flip)
+    {
+        draw(texture);
+        return SDL_RenderCopyExF(renderer, texture, source, destination,
+                                 angle, center, flip);
+    }
+
+    int geometry(SDL_Texture * texture,
+                 SDL_Vertex const * vertices, int vertex_count,
+                 int const * indices = nullptr, int index_count = 0)
+    {
+        draw(texture);
+        return SDL_RenderGeometry(renderer, texture, vertices, vertex_count,
+                                  indices, index_count);
+    }
+
+    /**
+     * \brief Upload pixels to a texture
+     *
+     * \param texture   to upload to
+     * \param area      the area to update, or nullptr for the whole texture
+     * \param pixels    the pixels to upload
+     * \param pitch     the bytes between rows of pixels
+     */
+    int update_texture(SDL_Texture * texture, SDL_Rect const * area,
+                       void const * pixels, int pitch)
+    {
+        int rows = 0;
+        if (area) {
+            rows = area->h;
+        }
+        else {
+            SDL_QueryTexture(texture, nullptr, nullptr, nullptr, &rows);
+        }
+        frame.upload_bytes += static_cast<std::size_t>(rows)
+                            * static_cast<std::size_t>(pitch);
+        return SDL_UpdateTexture(texture, area, pixels, pitch);
+    }
+
+    /**
+     * \brief Present the frame, log it if it's over a threshold, and start
+     *        counting the next one
+     */
+    void present()
+    {
+        SDL_RenderPresent(renderer);
+        if (log) { log_outliers(*log); }
+
+        previous = frame;
+        frame = {};
+        last_texture = nullptr;
+        last_blend.reset();
+        ++frame_count;
+    }
+
+private:
+    void draw(SDL_Texture * texture)
+    {
+        ++frame.draw_calls;
+
+        if (texture != last_texture) {
+            // the first draw of a frame starts its first batch, not a switch
+            if (frame.draw_calls > 1) { ++frame.texture_switches; }
+            last_texture = texture;
+        }
+
+        // untextured geometry is blended with the draw blend mode
+        SDL_BlendMode blend = SDL_BLENDMODE_NONE;
+        if (texture) { SDL_GetTextureBlendMode(texture, &blend); }
+        else { SDL_GetRenderDrawBlendMode(renderer, &blend); }
+
+        if (last_blend and *last_blend != blend) { ++frame.blend_changes; }
+        last_blend = blend;
+    }
+
+    void log_outliers(std::ostream & output) const
+    {
+        auto const over = [&](char const * name, auto count, auto threshold) {
+            if (threshold and count > *threshold) {
+                output << "frame " << frame_count << ": " << count << ' '
+                       << name << " (threshold " << *threshold << ")\n";
+            }
+        };
+        over("draw calls", frame.draw_calls, thresholds.draw_calls);
+        over("texture switches", frame.texture_switches,
+             thresholds.texture_switches);
+        over("blend changes", frame.blend_changes, thresholds.blend_changes);
+        over("upload bytes", frame.upload_bytes, thresholds.upload_bytes);
+    }
+
+    SDL_Renderer * renderer;
+    render_thresholds thresholds;
+    std::ostream * log;
+
+    render_stats frame;
+    render_stats previous;
+    std::uint64_t frame_count = 0;
+    SDL_Texture * last_texture = nullptr;
+    std::optional<SDL_BlendMode> last_blend;
+};
+
+/**
+ * \brief Load the thresholds above which a frame's render statistics are
+ *        logged
+ *
+ * toml parameters:
+ *
+ *  int draw-calls          OPTIONAL    the most draw calls in a frame
+ *  int texture-switches    OPTIONAL    the most texture switches in a frame
+ *  int blend-changes       OPTIONAL    the most blend mode changes in a frame
+ *  int upload-bytes        OPTIONAL    the most bytes uploaded in a frame
+ *
+ * \param table             the table with the thresholds
+ * \param variable_path     the toml path to the thresholds
+ *
+ * \return the thresholds, or a descriptive error message
+ */
+inline expected<render_thresholds, std::string>
+load_render_thresholds(toml::table const & table,
+                       std::string const & variable_path)
+{
+    auto const view = subtable_view(table, variable_path);
+    if (not view) { return unexpected(view.error()); }
+
+    render_thresholds thresholds;
+    auto const limit = [&](char const * key, auto & output)
+        -> expected<void, std::string>
+    {
+        auto const & node = (**view)[key];
+        if (not node) { return {}; }
+
+        auto const value = node.value<std::int64_t>();
+        if (not value or *value < 0) {
+            return unexpected(variable_path + "."s + key
+                              + " must be a non-negative integer"s);
+        }
+        output = static_cast<
+            typename std::remove_reference_t<decltype(output)>::value_type>(
+                *value);
+        return {};
+    };
+
+    for (auto const & result : {
+             limit("draw-calls", thresholds.draw_calls),
+             limit("texture-switches", thresholds.texture_switches),
+             limit("blend-changes", thresholds.blend_changes),
+             limit("upload-bytes", thresholds.upload_bytes) }) {
+        if (not result) { return unexpected(result.error()); }
+    }
+    return thresholds;
+}
+
+/**
+ * \brief Load render statistic thresholds into an output
+ *
+ * \param variable_path     the toml path to the thresholds
+ * \param output            where to store the thresholds
+ *
+ * \return a function that loads the thresholds from a table, and returns the
+ *         table or a descriptive error message
+ */
+inline auto load_render_thresholds(std::string const & variable_path,
+                                   render_thresholds & output)
+{
+    return [&variable_path, &output](toml::table const & table)
+        -> expected<toml::table, std::string>
+    {
+        auto result = load_render_thresholds(table, variable_path);
+        if (not result) { return unexpected(result.error()); }
+        output = *result;
+        return table;
+    };
+}
+}
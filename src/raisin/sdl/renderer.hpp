@@ -1,6 +1,7 @@
 #pragma once
 #include "raisin/future.hpp"
 #include "raisin/flags.hpp"
+#include "raisin/pipeline.hpp"
 
 // frameworks
 #include <SDL2/SDL.h>
@@ -16,6 +17,14 @@
 
 namespace raisin::sdl {
 
+inline std::unordered_map<std::string, std::uint32_t> const
+_as_renderer_flag{
+    { "software",       SDL_RENDERER_SOFTWARE },
+    { "accelerated",    SDL_RENDERER_ACCELERATED },
+    { "present-vsync",  SDL_RENDERER_PRESENTVSYNC },
+    { "target-texture", SDL_RENDERER_TARGETTEXTURE },
+};
+
 /**
  * Initialize SDL with the subsystems defined in a toml config file.
  *
@@ -44,16 +53,8 @@ load_renderer_flags(toml::table const & table,
                     std::string const & variable_path,
                     name_output into_invalid_names)
 {
-    static std::unordered_map<std::string, std::uint32_t>
-    const as_renderer_flag{
-        { "software",       SDL_RENDERER_SOFTWARE },
-        { "accelerated",    SDL_RENDERER_ACCELERATED },
-        { "present-vsync",  SDL_RENDERER_PRESENTVSYNC },
-        { "target-texture", SDL_RENDERER_TARGETTEXTURE },
-    };
-
     return load_flags<max_flags>(table, variable_path,
-                                 as_renderer_flag, into_invalid_names);
+                                 _as_renderer_flag, into_invalid_names);
 }
 
 /**
@@ -74,8 +75,8 @@ auto load_renderer_flags_into(std::string const & variable_path,
                               std::uint32_t & flag_output,
                               name_output into_invalid_names)
 {
-    return _load_flags(load_renderer_flags<max_flags, name_output>,
-                       variable_path, flag_output, into_invalid_names);
+    return _load_flags<max_flags>(_as_renderer_flag, variable_path,
+                                  flag_output, into_invalid_names);
 }
 
 /**
@@ -115,12 +116,12 @@ auto load_renderer(std::string const & variable_path,
     {
         std::uint32_t flags;
         int driver_index;
-        auto result = subtable(table, variable_path)
+        auto result = subtable_view(table, variable_path)
             .and_then(load_renderer_flags_into<max_flags>(
-                "flags", flags, into_invalid_names))
-            .map(load_or_else("driver_index", driver_index, -1));
+                        "flags", flags, into_invalid_names)
+                    | load_or_else("driver_index", driver_index, -1));
 
-        if (not result) { return result; }
+        if (not result) { return unexpected(result.error()); }
 
         renderer_output = SDL_CreateRenderer(window, driver_index, flags);
         if (not renderer_output) {
@@ -27,6 +27,18 @@
 
 namespace raisin::sdl {
 
+inline std::unordered_map<std::string, std::uint32_t> const
+_as_subsystem_flag{
+    { "timer",              SDL_INIT_TIMER },
+    { "audio",              SDL_INIT_AUDIO },
+    { "video",              SDL_INIT_VIDEO },
+    { "joystick",           SDL_INIT_JOYSTICK },
+    { "haptic",             SDL_INIT_HAPTIC },
+    { "game-controller",    SDL_INIT_GAMECONTROLLER },
+    { "events",             SDL_INIT_EVENTS },
+    { "everything",         SDL_INIT_EVERYTHING }
+};
+
 /**
  * \brief Load SDL subsystem flags.
  *
@@ -49,20 +61,8 @@ load_subsystem_flags(toml::table const & table,
                      std::string const & variable_path,
                      name_output into_invalid_names)
 {
-    static std::unordered_map<std::string, std::uint32_t>
-    const as_subsystem_flag{
-        { "timer",              SDL_INIT_TIMER },
-        { "audio",              SDL_INIT_AUDIO },
-        { "video",              SDL_INIT_VIDEO },
-        { "joystick",           SDL_INIT_JOYSTICK },
-        { "haptic",             SDL_INIT_HAPTIC },
-        { "game-controller",    SDL_INIT_GAMECONTROLLER },
-        { "events",             SDL_INIT_EVENTS },
-        { "everything",         SDL_INIT_EVERYTHING }
-    };
-
     return load_flags<max_flags>(table, variable_path,
-                                 as_subsystem_flag, into_invalid_names);
+                                 _as_subsystem_flag, into_invalid_names);
 }
 
 /**
@@ -83,8 +83,8 @@ auto load_subsystem_flags_into(std::string const & variable_path,
                                std::uint32_t & flag_output,
                                name_output into_invalid_names)
 {
-    return _load_flags(load_subsystem_flags<max_flags, name_output>,
-                       variable_path, flag_output, into_invalid_names);
+    return _load_flags<max_flags>(_as_subsystem_flag, variable_path,
+                                  flag_output, into_invalid_names);
 }
 
 /**
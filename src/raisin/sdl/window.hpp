@@ -1,6 +1,7 @@
 #pragma once
 #include "raisin/future.hpp"
 #include "raisin/flags.hpp"
+#include "raisin/pipeline.hpp"
 
 // low-level frameworks
 #include <SDL2/SDL.h>
@@ -11,6 +12,8 @@
 
 // data structures
 #include <unordered_map>
+#include <optional>
+#include <utility>
 
 // serialization
 #define TOML_EXCEPTIONS 0
@@ -18,6 +21,23 @@
 
 namespace raisin::sdl {
 
+inline std::unordered_map<std::string, std::uint32_t> const
+_as_window_flag{
+    { "fullscreen",         SDL_WINDOW_FULLSCREEN },
+    { "fullscreen-desktop", SDL_WINDOW_FULLSCREEN_DESKTOP },
+    { "opengl",             SDL_WINDOW_OPENGL },
+    { "vulkan",             SDL_WINDOW_VULKAN },
+    { "metal",              SDL_WINDOW_METAL },
+    { "hidden",             SDL_WINDOW_HIDDEN },
+    { "borderless",         SDL_WINDOW_BORDERLESS },
+    { "resizable",          SDL_WINDOW_RESIZABLE },
+    { "minimized",          SDL_WINDOW_MINIMIZED },
+    { "maximized",          SDL_WINDOW_MAXIMIZED },
+    { "input-grabbed",      SDL_WINDOW_INPUT_GRABBED },
+    { "allow-high-dpi",     SDL_WINDOW_ALLOW_HIGHDPI },
+    { "shown",              SDL_WINDOW_SHOWN }
+};
+
 /**
  * Parse SDL window flags from a toml::table
  *
@@ -55,25 +75,8 @@ load_window_flags(toml::table const & table,
                   std::string const & variable_path,
                   name_output into_invalid_names)
 {
-    static std::unordered_map<std::string, std::uint32_t>
-    const as_window_flag{
-        { "fullscreen",         SDL_WINDOW_FULLSCREEN },
-        { "fullscreen-desktop", SDL_WINDOW_FULLSCREEN_DESKTOP },
-        { "opengl",             SDL_WINDOW_OPENGL },
-        { "vulkan",             SDL_WINDOW_VULKAN },
-        { "metal",              SDL_WINDOW_METAL },
-        { "hidden",             SDL_WINDOW_HIDDEN },
-        { "borderless",         SDL_WINDOW_BORDERLESS },
-        { "resizable",          SDL_WINDOW_RESIZABLE },
-        { "minimized",          SDL_WINDOW_MINIMIZED },
-        { "maximized",          SDL_WINDOW_MAXIMIZED },
-        { "input-grabbed",      SDL_WINDOW_INPUT_GRABBED },
-        { "allow-high-dpi",     SDL_WINDOW_ALLOW_HIGHDPI },
-        { "shown",              SDL_WINDOW_SHOWN }
-    };
-
     return load_flags<max_flags>(table, variable_path,
-                                 as_window_flag, into_invalid_names);
+                                 _as_window_flag, into_invalid_names);
 }
 
 /**
@@ -94,8 +97,8 @@ auto load_window_flags_into(std::string const & variable_path,
                             std::uint32_t & flag_output,
                             name_output into_invalid_names)
 {
-    return _load_flags(load_window_flags<max_flags, name_output>,
-                       variable_path, flag_output, into_invalid_names);
+    return _load_flags<max_flags>(_as_window_flag, variable_path,
+                                  flag_output, into_invalid_names);
 }
 
 /**
@@ -112,6 +115,9 @@ auto load_window_flags_into(std::string const & variable_path,
  *       See documentation for load_window_flags for a list of valid window
  *       flags.
  *
+ * \note Every parameter is loaded even when another fails to load, so the
+ *       error lists every bad parameter, one per line.
+ *
  * toml parameters:
  *
  *  string title        REQUIRED
@@ -138,16 +144,16 @@ auto load_window(std::string const & variable_path,
         std::uint32_t width, height, flags;
         int constexpr anywhere = static_cast<int>(SDL_WINDOWPOS_UNDEFINED);
 
-        auto result = subtable(table, variable_path)
-            .and_then(load("title", title))
-            .and_then(load("width", width))
-            .and_then(load("height", height))
-            .and_then(load_window_flags_into<max_flags>(
-                "flags", flags, into_invalid_names))
-            .map(load_or_else("x", x, anywhere))
-            .map(load_or_else("y", y, anywhere));
+        auto result = subtable_view(table, variable_path)
+            .and_then(load("title", title)
+                    | load("width", width)
+                    | load("height", height)
+                    | load_window_flags_into<max_flags>(
+                        "flags", flags, into_invalid_names)
+                    | load_or_else("x", x, anywhere)
+                    | load_or_else("y", y, anywhere));
 
-        if (not result) { return result; }
+        if (not result) { return unexpected(result.error()); }
 
         window_output = SDL_CreateWindow(
                 title.c_str(), x, y, width, height, flags);
@@ -157,4 +163,214 @@ auto load_window(std::string const & variable_path,
         return table;
     };
 }
+
+/**
+ * \brief How a window coalesces resize events
+ */
+struct resize_settings {
+    // the milliseconds a window's size must hold still before size-dependent
+    // resources are re-created
+    std::uint32_t debounce = 150;
+
+    // the pixel format of the render target
+    std::uint32_t format = SDL_PIXELFORMAT_ARGB8888;
+};
+
+/**
+ * \brief Load resize settings from a window's table
+ *
+ * \param variable_path     the toml path to the window parameters
+ * \param settings_output   where to write the settings
+ *
+ * \return a function taking a toml::table and returning an expected table
+ *         result, such that the settings are written to settings_output
+ *
+ * toml parameters:
+ *
+ *  int resize-debounce     OPTIONAL    the milliseconds to wait for resizing
+ *                                      to stop, defaults to 150
+ */
+inline auto load_resize(std::string const & variable_path,
+                        resize_settings & settings_output)
+{
+    return [&variable_path, &settings_output](toml::table const & table)
+        -> expected<toml::table, std::string>
+    {
+        auto const window = subtable_view(table, variable_path);
+        if (not window) { return unexpected(window.error()); }
+
+        settings_output.debounce = load_value_or_else(
+                **window, "resize-debounce"s, resize_settings{}.debounce);
+        return table;
+    };
+}
+
+/**
+ * \brief A render target that follows a window's size, re-created once
+ *        resizing stops
+ *
+ * Dragging a window's edge sends a storm of size changes. Rather than
+ * re-creating size-dependent resources for each one, the frame is drawn to a
+ * render target at the last settled size and stretched over the window, and
+ * the target is re-created only when the size has held still for the
+ * debounce time:
+ *
+ *      while (SDL_PollEvent(&event)) {
+ *          if (target->handle(event)) { continue; }
+ *          ...
+ *      }
+ *      auto resized = target->update();
+ *      if (resized and *resized) { layout(**resized); }
+ *      target->begin();
+ *      draw();
+ *      target->present();
+ */
+class resizable_target {
+public:
+    /**
+     * \brief Create a render target the size of a renderer's output
+     *
+     * \return the target, or a descriptive error message
+     */
+    static expected<resizable_target, std::string>
+    create(SDL_Window * window, SDL_Renderer * renderer,
+           resize_settings const & settings = {})
+    {
+        resizable_target target{ window, renderer, settings };
+        auto error = target.recreate();
+        if (error) { return unexpected{ *error }; }
+        return target;
+    }
+
+    resizable_target(resizable_target && other) noexcept
+        : window{ other.window }, renderer{ other.renderer },
+          settings{ other.settings }, texture{ std::exchange(other.texture, nullptr) },
+          target_size{ other.target_size }, pending{ other.pending },
+          deadline{ other.deadline }
+    {
+    }
+
+    resizable_target & operator=(resizable_target && other) noexcept
+    {
+        std::swap(window, other.window);
+        std::swap(renderer, other.renderer);
+        std::swap(settings, other.settings);
+        std::swap(texture, other.texture);
+        std::swap(target_size, other.target_size);
+        std::swap(pending, other.pending);
+        std::swap(deadline, other.deadline);
+        return *this;
+    }
+
+    ~resizable_target()
+    {
+        if (texture) { SDL_DestroyTexture(texture); }
+    }
+
+    /**
+     * \brief Note a resize of the window
+     *
+     * \return whether the event was a size change of this target's window
+     */
+    bool handle(SDL_Event const & event)
+    {
+        if (event.type != SDL_WINDOWEVENT or
+            event.window.event != SDL_WINDOWEVENT_SIZE_CHANGED or
+            event.window.windowID != SDL_GetWindowID(window)) {
+            return false;
+        }
+        pending = true;
+        deadline = event.window.timestamp + settings.debounce;
+        return true;
+    }
+
+    /**
+     * \brief Re-create the target if the window's size has settled
+     *
+     * \param now   the current time in milliseconds, as from SDL_GetTicks
+     *
+     * \return the new size of the target if it was re-created, or nothing if
+     *         it wasn't, or a descriptive error message if re-creating it
+     *         failed
+     */
+    expected<std::optional<SDL_Point>, std::string>
+    update(std::uint32_t now = SDL_GetTicks())
+    {
+        if (not pending or not SDL_TICKS_PASSED(now, deadline)) {
+            return std::optional<SDL_Point>{};
+        }
+        pending = false;
+
+        int width, height;
+        if (SDL_GetRendererOutputSize(renderer, &width, &height) != 0) {
+            return unexpected{ std::string{ SDL_GetError() } };
+        }
+        if (width == target_size.x and height == target_size.y) {
+            return std::optional<SDL_Point>{};
+        }
+        auto error = recreate();
+        if (error) { return unexpected{ *error }; }
+        return std::optional<SDL_Point>{ target_size };
+    }
+
+    /**
+     * \brief Whether the window is being resized, so the frame is being
+     *        stretched
+     */
+    bool resizing() const { return pending; }
+
+    /**
+     * \brief The size of the target, which is the size to lay out and draw at
+     */
+    SDL_Point size() const { return target_size; }
+
+    SDL_Texture * texture_handle() const { return texture; }
+
+    /**
+     * \brief Draw to the target
+     */
+    void begin() const { SDL_SetRenderTarget(renderer, texture); }
+
+    /**
+     * \brief Stretch the target over the window and present it
+     */
+    void present() const
+    {
+        SDL_SetRenderTarget(renderer, nullptr);
+        SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+        SDL_RenderPresent(renderer);
+    }
+
+private:
+    resizable_target(SDL_Window * window, SDL_Renderer * renderer,
+                     resize_settings const & settings)
+        : window{ window }, renderer{ renderer }, settings{ settings }
+    {
+    }
+
+    SDL_Window * window;
+    SDL_Renderer * renderer;
+    resize_settings settings;
+    SDL_Texture * texture = nullptr;
+    SDL_Point target_size{ 0, 0 };
+    bool pending = false;
+    std::uint32_t deadline = 0;
+
+    std::optional<std::string> recreate()
+    {
+        int width, height;
+        if (SDL_GetRendererOutputSize(renderer, &width, &height) != 0) {
+            return SDL_GetError();
+        }
+        SDL_Texture * created = SDL_CreateTexture(
+                renderer, settings.format, SDL_TEXTUREACCESS_TARGET,
+                width, height);
+        if (not created) { return SDL_GetError(); }
+
+        if (texture) { SDL_DestroyTexture(texture); }
+        texture = created;
+        target_size = { width, height };
+        return std::nullopt;
+    }
+};
 }
@@ -0,0 +1,306 @@
+#pragma once
+#include "raisin/future.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// data structures
+#include <vector>
+#include <span>
+#include <utility>
+
+// algorithms
+#include <algorithm>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+// i/o
+#include <filesystem>
+#include <fstream>
+
+namespace raisin {
+
+using namespace std::string_literals;
+
+/**
+ * \brief A top-level section of a toml document
+ *
+ * A section is a [table] or [[array]] header line and everything up to the
+ * next header, or the key-value pairs before the first header, which have an
+ * empty key and no header.
+ */
+struct toml_section {
+    // the first key of the header, e.g. "window" for [window.size]
+    std::string_view key;
+
+    // the text between the header's brackets, e.g. "window.size"
+    std::string_view header;
+    bool is_array_of_tables = false;
+
+    // the byte range of the section in the document
+    std::size_t begin = 0;
+    std::size_t end = 0;
+
+    // the line the section starts on, counting from 1
+    std::size_t line = 1;
+};
+
+inline bool _is_bare_key_char(char ch)
+{
+    return (ch >= 'a' and ch <= 'z') or (ch >= 'A' and ch <= 'Z') or
+           (ch >= '0' and ch <= '9') or ch == '_' or ch == '-';
+}
+
+/**
+ * \brief Find the end of a string that starts at an offset
+ *
+ * \return the offset just past the closing quote(s), or the end of the
+ *         document if the string is never closed
+ */
+inline std::size_t _skip_string(std::string_view document, std::size_t offset)
+{
+    char const quote = document[offset];
+    bool const multiline = document.substr(offset, 3) ==
+                           std::string_view{ quote == '"' ? "\"\"\"" : "'''" };
+    bool const escapes = quote == '"';
+
+    if (not multiline) {
+        for (std::size_t i = offset + 1; i < document.size(); ++i) {
+            if (escapes and document[i] == '\\') { ++i; continue; }
+            if (document[i] == quote or document[i] == '\n') { return i + 1; }
+        }
+        return document.size();
+    }
+
+    std::string_view const delimiter = document.substr(offset, 3);
+    std::size_t i = offset + 3;
+    while (i < document.size()) {
+        if (escapes and document[i] == '\\') { i += 2; continue; }
+        if (document.substr(i, 3) == delimiter) {
+            // up to two quotes may directly precede the closing delimiter
+            i += 3;
+            for (int extra = 0; extra < 2 and i < document.size() and
+                                document[i] == quote; ++extra) {
+                ++i;
+            }
+            return i;
+        }
+        ++i;
+    }
+    return document.size();
+}
+
+/**
+ * \brief Read the first key of a header, unquoting it if it's quoted
+ */
+inline std::string_view _first_header_key(std::string_view header)
+{
+    std::size_t i = header.find_first_not_of("[ \t");
+    if (i == std::string_view::npos) { return {}; }
+
+    if (header[i] == '"' or header[i] == '\'') {
+        std::size_t const close = header.find(header[i], i + 1);
+        if (close == std::string_view::npos) { return {}; }
+        return header.substr(i + 1, close - i - 1);
+    }
+    std::size_t end = i;
+    while (end < header.size() and _is_bare_key_char(header[end])) { ++end; }
+    return header.substr(i, end - i);
+}
+
+/**
+ * \brief Split a toml document into its top-level sections
+ *
+ * This is a structural scan rather than a parse: it skips strings (including
+ * multi-line strings), comments, and multi-line arrays and inline tables, so
+ * only real header lines start a section. The document isn't validated.
+ *
+ * \param document  the text of a toml document
+ *
+ * \return the sections in the order they appear. If there are any key-value
+ *         pairs before the first header, the first section is those pairs,
+ *         with an empty key.
+ */
+inline std::vector<toml_section> split_sections(std::string_view document)
+{
+    std::vector<toml_section> sections;
+    toml_section current;
+    std::size_t line = 1;
+    std::size_t depth = 0;
+    bool line_start = true;
+
+    auto const start_section = [&](std::size_t offset) {
+        current.end = offset;
+        if (current.end > current.begin) {
+            sections.push_back(current);
+        }
+        current = toml_section{};
+        current.begin = offset;
+        current.line = line;
+    };
+
+    std::size_t i = 0;
+    while (i < document.size()) {
+        char const ch = document[i];
+        if (ch == '\n') {
+            ++line;
+            ++i;
+            line_start = true;
+            continue;
+        }
+        if (ch == ' ' or ch == '\t' or ch == '\r') {
+            ++i;
+            continue;
+        }
+
+        if (line_start and depth == 0 and ch == '[') {
+            // a header: the section starts at the beginning of its line
+            std::size_t const newline = document.rfind('\n', i);
+            start_section(newline == std::string_view::npos ?
+                          0 : newline + 1);
+
+            current.is_array_of_tables = document.substr(i, 2) == "[[";
+            std::size_t header_end = i + 1;
+            while (header_end < document.size() and
+                   document[header_end] != ']' and
+                   document[header_end] != '\n') {
+                if (document[header_end] == '"' or
+                    document[header_end] == '\'') {
+                    header_end = _skip_string(document, header_end);
+                }
+                else {
+                    ++header_end;
+                }
+            }
+            current.key = _first_header_key(
+                    document.substr(i, header_end - i));
+
+            std::string_view header = document.substr(i, header_end - i);
+            header.remove_prefix(std::min(header.find_first_not_of("[ \t"),
+                                          header.size()));
+            header = header.substr(0, header.find_last_not_of(" \t") + 1);
+            current.header = header;
+
+            // skip the rest of the header line, including any comment
+            std::size_t const next_line = document.find('\n', header_end);
+            i = next_line == std::string_view::npos ?
+                document.size() : next_line;
+            line_start = false;
+            continue;
+        }
+
+        line_start = false;
+        switch (ch) {
+        case '#': {
+            std::size_t const next_line = document.find('\n', i);
+            i = next_line == std::string_view::npos ?
+                document.size() : next_line;
+            break;
+        }
+        case '"':
+        case '\'': {
+            std::size_t const end = _skip_string(document, i);
+            for (std::size_t j = i; j < end; ++j) {
+                if (document[j] == '\n') { ++line; }
+            }
+            // a basic string ending at a newline is unterminated; treat the
+            // newline as the end of the line
+            if (document[end - 1] == '\n') { line_start = true; }
+            i = end;
+            break;
+        }
+        case '[':
+        case '{':
+            ++depth;
+            ++i;
+            break;
+        case ']':
+        case '}':
+            if (depth > 0) { --depth; }
+            ++i;
+            break;
+        default:
+            ++i;
+            break;
+        }
+    }
+    start_section(document.size());
+    return sections;
+}
+
+/**
+ * \brief Read a whole file into a string
+ *
+ * \param config_path   the path to the file
+ *
+ * \return the contents of the file, or a descriptive error message
+ */
+inline expected<std::string, std::string>
+read_text_file(std::string const & config_path)
+{
+    if (not std::filesystem::exists(config_path)) {
+        std::string const description =
+            "Expecting config at "s + config_path + ", "s
+            "but the file doesn't exist"s;
+        return unexpected{ description };
+    }
+
+    std::ifstream file{ config_path, std::ios::binary };
+    std::string text(std::filesystem::file_size(config_path), '\0');
+    if (not file.read(text.data(), static_cast<std::streamsize>(text.size()))) {
+        std::string const description =
+            "Couldn't read config at "s + config_path;
+        return unexpected{ description };
+    }
+    return text;
+}
+
+/**
+ * \brief Parse some of the sections of a toml document together
+ *
+ * \param document      the text of the document
+ * \param sections      the sections to parse, in the order to parse them
+ * \param source_path   the path of the document, for error messages
+ *
+ * \return the table of just those sections, or a descriptive message with
+ *         the line in the original document of any error
+ */
+inline expected<toml::table, std::string>
+parse_sections(std::string_view document,
+               std::span<toml_section const> sections,
+               std::string const & source_path = ""s)
+{
+    // join the sections, remembering where each one came from
+    std::string joined;
+    std::vector<std::pair<std::size_t, std::size_t>> lines;
+    std::size_t joined_line = 1;
+    for (toml_section const & section : sections) {
+        std::string_view const source = document.substr(
+                section.begin, section.end - section.begin);
+        lines.emplace_back(joined_line, section.line);
+        joined.append(source);
+        if (not source.ends_with('\n')) { joined += '\n'; }
+        joined_line += std::ranges::count(source, '\n') +
+                       (source.ends_with('\n') ? 0 : 1);
+    }
+
+    toml::parse_result result = toml::parse(joined, source_path);
+    if (not result) {
+        // map the error back to its line in the original document
+        std::size_t const line = result.error().source().begin.line;
+        std::size_t original = line;
+        for (auto const & [first, source_line] : lines) {
+            if (first <= line) { original = source_line + line - first; }
+        }
+        std::string const description =
+            "Couldn't parse line "s + std::to_string(original) + ": "s +
+            std::string{ result.error().description() };
+        return unexpected{ description };
+    }
+    return std::move(result).table();
+}
+}
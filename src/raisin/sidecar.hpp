@@ -0,0 +1,357 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+#include "raisin/mapped_file.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <bit>
+
+// data structures
+#include <span>
+#include <vector>
+#include <optional>
+#include <utility>
+
+// algorithms
+#include <algorithm>
+
+// type constraints
+#include <concepts>
+#include <type_traits>
+
+// i/o
+#include <filesystem>
+#include <fstream>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin {
+
+using namespace std::string_literals;
+
+/**
+ * \brief The name of an element type in a sidecar descriptor, e.g. "u16"
+ */
+template<typename element_t>
+inline constexpr std::string_view sidecar_type_name = "";
+
+template<> inline constexpr std::string_view sidecar_type_name<std::uint8_t> = "u8";
+template<> inline constexpr std::string_view sidecar_type_name<std::uint16_t> = "u16";
+template<> inline constexpr std::string_view sidecar_type_name<std::uint32_t> = "u32";
+template<> inline constexpr std::string_view sidecar_type_name<std::uint64_t> = "u64";
+template<> inline constexpr std::string_view sidecar_type_name<std::int8_t> = "i8";
+template<> inline constexpr std::string_view sidecar_type_name<std::int16_t> = "i16";
+template<> inline constexpr std::string_view sidecar_type_name<std::int32_t> = "i32";
+template<> inline constexpr std::string_view sidecar_type_name<std::int64_t> = "i64";
+template<> inline constexpr std::string_view sidecar_type_name<float> = "f32";
+template<> inline constexpr std::string_view sidecar_type_name<double> = "f64";
+
+template<typename element_t>
+concept sidecar_element = not sidecar_type_name<element_t>.empty();
+
+/**
+ * \brief A numeric array stored in a binary file next to a config
+ *
+ * Large arrays don't belong inline in toml, where every element is a node.
+ * Instead, a config refers to a sidecar file of raw little-endian elements:
+ *
+ *      heights = { sidecar = "level1.heights.bin", type = "u16", shape = [2048, 2048] }
+ *
+ * The sidecar is mapped into memory, so it loads as fast as the disk can read
+ * it, and its elements are read in place.
+ *
+ * \note On big-endian machines the elements are byte swapped into a buffer
+ *       instead of being read in place.
+ */
+template<sidecar_element element_t>
+class sidecar_array {
+public:
+    sidecar_array() = default;
+
+    /**
+     * \brief Read the elements of a mapped sidecar file
+     *
+     * \param file      the sidecar file
+     * \param shape     the size of each dimension, outermost first
+     */
+    sidecar_array(mapped_file file, std::vector<std::size_t> shape)
+        : dimensions{ std::move(shape) }
+    {
+        auto const bytes = file.bytes();
+        std::size_t const count = bytes.size() / sizeof(element_t);
+        bool const aligned = reinterpret_cast<std::uintptr_t>(bytes.data()) %
+                             alignof(element_t) == 0;
+
+        if (std::endian::native == std::endian::little and aligned) {
+            data = { reinterpret_cast<element_t const *>(bytes.data()), count };
+            this->file.emplace(std::move(file));
+            return;
+        }
+
+        buffer.resize(count);
+        std::memcpy(buffer.data(), bytes.data(), count * sizeof(element_t));
+        if constexpr (std::endian::native != std::endian::little) {
+            for (element_t & element : buffer) {
+                auto * raw = reinterpret_cast<unsigned char *>(&element);
+                std::reverse(raw, raw + sizeof(element_t));
+            }
+        }
+        data = buffer;
+    }
+
+    /**
+     * \brief The elements, in row-major order
+     */
+    std::span<element_t const> values() const { return data; }
+
+    /**
+     * \brief The size of each dimension, outermost first
+     */
+    std::span<std::size_t const> shape() const { return dimensions; }
+
+    std::size_t size() const { return data.size(); }
+    bool empty() const { return data.empty(); }
+    element_t const & operator[](std::size_t index) const { return data[index]; }
+    auto begin() const { return data.begin(); }
+    auto end() const { return data.end(); }
+
+    /**
+     * \brief Whether the elements are read in place from the mapped file,
+     *        rather than from a buffer
+     */
+    bool is_mapped() const { return file.has_value(); }
+
+private:
+    std::optional<mapped_file> file;
+    std::vector<element_t> buffer;
+    std::span<element_t const> data;
+    std::vector<std::size_t> dimensions;
+};
+
+/**
+ * \brief Load a numeric array from the sidecar file a config refers to
+ *
+ * \param table             the table with the sidecar descriptor
+ * \param variable_path     the toml path to the descriptor
+ * \param directory         the directory sidecar paths are relative to,
+ *                          usually the config's directory
+ *
+ * \return the array, or a descriptive error message if the descriptor is
+ *         malformed, or the file doesn't exist or doesn't match the
+ *         descriptor's type and shape
+ */
+template<sidecar_element element_t>
+expected<sidecar_array<element_t>, std::string>
+load_sidecar(toml::table const & table,
+             std::string const & variable_path,
+             std::filesystem::path const & directory = {})
+{
+    auto const descriptor = subtable_view(table, variable_path);
+    if (not descriptor) { return unexpected(descriptor.error()); }
+
+    auto const malformed = [&variable_path](std::string const & reason) {
+        return unexpected{ variable_path + " must be a sidecar descriptor "s +
+                           "with "s + reason };
+    };
+    auto const sidecar = (**descriptor)["sidecar"].value<std::string>();
+    auto const type = (**descriptor)["type"].value<std::string>();
+    auto const * shape_array = (**descriptor)["shape"].as_array();
+    if (not sidecar) { return malformed("a sidecar path"s); }
+    if (not type) { return malformed("an element type"s); }
+    if (not shape_array or shape_array->empty()) {
+        return malformed("a shape"s);
+    }
+
+    if (*type != sidecar_type_name<element_t>) {
+        std::string const description =
+            variable_path + " has elements of type "s + *type +
+            ", but expected "s + std::string{ sidecar_type_name<element_t> };
+        return unexpected{ description };
+    }
+
+    std::vector<std::size_t> shape;
+    std::size_t count = 1;
+    for (toml::node const & dimension : *shape_array) {
+        auto const size = dimension.value<std::int64_t>();
+        if (not size or *size < 0) {
+            return malformed("a shape of non-negative integers"s);
+        }
+        // a corrupt shape mustn't wrap around to the size of a small file
+        auto const extent = static_cast<std::uint64_t>(*size);
+        if (extent > SIZE_MAX or
+            (extent != 0 and count > SIZE_MAX / extent)) {
+            return malformed("a shape that fits in memory"s);
+        }
+        shape.push_back(static_cast<std::size_t>(extent));
+        count *= shape.back();
+    }
+    if (count > SIZE_MAX / sizeof(element_t)) {
+        return malformed("a shape that fits in memory"s);
+    }
+
+    std::string const path = (directory / *sidecar).string();
+    auto file = mapped_file::open(path);
+    if (not file) { return unexpected(file.error()); }
+
+    std::size_t const expected_size = count * sizeof(element_t);
+    if (file->bytes().size() != expected_size) {
+        std::string const description =
+            path + " must be "s + std::to_string(expected_size) +
+            " bytes for the shape of "s + variable_path + ", but it's "s +
+            std::to_string(file->bytes().size()) + " bytes"s;
+        return unexpected{ description };
+    }
+    return sidecar_array<element_t>{ std::move(*file), std::move(shape) };
+}
+
+/**
+ * \brief Load a numeric array from a sidecar file into an output
+ *
+ * \param variable_path     the toml path to the sidecar descriptor
+ * \param output            where to store the array
+ * \param directory         the directory sidecar paths are relative to
+ *
+ * \return a function that loads the array from a table, and returns the table
+ *         or a descriptive error message
+ */
+template<sidecar_element element_t>
+auto load_sidecar(std::string const & variable_path,
+                  sidecar_array<element_t> & output,
+                  std::filesystem::path const & directory = {})
+{
+    return [&variable_path, &output, directory](toml::table const & table)
+        -> expected<toml::table, std::string>
+    {
+        auto result = load_sidecar<element_t>(table, variable_path, directory);
+        if (not result) { return unexpected(result.error()); }
+        output = std::move(*result);
+        return table;
+    };
+}
+
+template<sidecar_element element_t>
+std::optional<std::string>
+_flatten_array(toml::array const & array, std::size_t depth,
+               std::vector<std::size_t> & shape,
+               std::optional<std::size_t> & value_depth,
+               std::vector<element_t> & values)
+{
+    if (depth == shape.size()) {
+        shape.push_back(array.size());
+    }
+    else if (shape[depth] != array.size()) {
+        return "rows of different lengths"s;
+    }
+
+    for (toml::node const & node : array) {
+        if (auto const * row = node.as_array()) {
+            if (value_depth and *value_depth <= depth) {
+                return "rows of different depths"s;
+            }
+            auto error = _flatten_array(*row, depth + 1, shape,
+                                        value_depth, values);
+            if (error) { return error; }
+            continue;
+        }
+        if (value_depth and *value_depth != depth) {
+            return "rows of different depths"s;
+        }
+        value_depth = depth;
+
+        std::optional<element_t> value;
+        if constexpr (std::floating_point<element_t>) {
+            value = node.value<element_t>();
+        }
+        else if (auto const integer = node.value<std::int64_t>()) {
+            if (std::in_range<element_t>(*integer)) {
+                value = static_cast<element_t>(*integer);
+            }
+        }
+        if (not value) {
+            return "values that aren't "s +
+                   std::string{ sidecar_type_name<element_t> } + " values"s;
+        }
+        values.push_back(*value);
+    }
+    return std::nullopt;
+}
+
+/**
+ * \brief Move an inline numeric array out of a config into a sidecar file
+ *
+ * The array is written to the sidecar file, and replaced in the table by a
+ * descriptor that load_sidecar can load. Nested arrays become dimensions of
+ * the shape, so they must be rectangular.
+ *
+ * \param table             the table with the inline array
+ * \param variable_path     the toml path to the array
+ * \param sidecar_path      the path of the sidecar file to write, relative to
+ *                          the directory
+ * \param directory         the directory sidecar paths are relative to
+ *
+ * \return nothing, or a descriptive error message if the array couldn't be
+ *         converted
+ *
+ * \note This is for tools that convert configs; save the table afterwards.
+ */
+template<sidecar_element element_t>
+expected<void, std::string>
+write_sidecar(toml::table & table,
+              std::string const & variable_path,
+              std::string const & sidecar_path,
+              std::filesystem::path const & directory = {})
+{
+    auto const * array = table.at_path(variable_path).as_array();
+    if (not array) {
+        return unexpected{ variable_path + " must be an array"s };
+    }
+
+    std::vector<std::size_t> shape;
+    std::optional<std::size_t> value_depth;
+    std::vector<element_t> values;
+    auto const error = _flatten_array(*array, 0, shape, value_depth, values);
+    if (error) {
+        return unexpected{ variable_path + " has "s + *error };
+    }
+
+    // the array's parent table, which gets the descriptor in its place
+    std::size_t const separator = variable_path.rfind('.');
+    std::string const key = variable_path.substr(separator + 1);
+    toml::table * parent = separator == std::string::npos ? &table :
+        table.at_path(variable_path.substr(0, separator)).as_table();
+    if (not parent or not parent->contains(key)) {
+        return unexpected{ variable_path + " must be a key in a table"s };
+    }
+
+    std::string const path = (directory / sidecar_path).string();
+    std::ofstream file{ path, std::ios::binary };
+    for (element_t value : values) {
+        unsigned char bytes[sizeof(element_t)];
+        std::memcpy(bytes, &value, sizeof(element_t));
+        if constexpr (std::endian::native != std::endian::little) {
+            std::reverse(bytes, bytes + sizeof(element_t));
+        }
+        file.write(reinterpret_cast<char const *>(bytes), sizeof(element_t));
+    }
+    if (not file.flush()) { return unexpected{ "Couldn't write "s + path }; }
+
+    toml::array shape_array;
+    for (std::size_t dimension : shape) {
+        shape_array.push_back(static_cast<std::int64_t>(dimension));
+    }
+    toml::table descriptor;
+    descriptor.insert("sidecar", sidecar_path);
+    descriptor.insert("type", std::string{ sidecar_type_name<element_t> });
+    descriptor.insert("shape", std::move(shape_array));
+    descriptor.is_inline(true);
+    parent->insert_or_assign(key, std::move(descriptor));
+    return {};
+}
+}
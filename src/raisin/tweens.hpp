@@ -0,0 +1,547 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+
+// data types
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <cassert>
+
+// data structures
+#include <map>
+#include <span>
+#include <array>
+#include <vector>
+#include <optional>
+
+// algorithms
+#include <algorithm>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+namespace raisin {
+
+using namespace std::string_literals;
+
+namespace limits {
+// the number of segments a cubic bezier easing is baked into
+std::size_t constexpr easing_table_size = 64;
+}
+
+using easing_id = std::uint16_t;
+using tween_id = std::uint32_t;
+
+/**
+ * \brief The built-in easing functions, whose ids are their values
+ */
+enum class easing : easing_id {
+    linear,
+    quad_in,
+    quad_out,
+    quad_in_out,
+    cubic_in,
+    cubic_out,
+    cubic_in_out,
+    sine_in,
+    sine_out,
+    sine_in_out,
+    back_out,
+    count
+};
+
+inline constexpr std::array<std::string_view, static_cast<std::size_t>(easing::count)>
+_easing_names{
+    "linear", "quad-in", "quad-out", "quad-in-out", "cubic-in", "cubic-out",
+    "cubic-in-out", "sine-in", "sine-out", "sine-in-out", "back-out" };
+
+/**
+ * \brief Ease every value of a batch in place with a built-in easing
+ *
+ * Each case is a branch-free loop, so the compiler can vectorize it.
+ */
+inline void _ease(easing function, std::span<float> values)
+{
+    float constexpr half_pi = 1.5707963267948966f;
+    float constexpr pi = 3.141592653589793f;
+    switch (function) {
+    case easing::linear:
+        break;
+    case easing::quad_in:
+        for (float & t : values) { t = t * t; }
+        break;
+    case easing::quad_out:
+        for (float & t : values) { t = t * (2.0f - t); }
+        break;
+    case easing::quad_in_out:
+        for (float & t : values) {
+            float const u = 2.0f - 2.0f * t;
+            t = t < 0.5f ? 2.0f * t * t : 1.0f - 0.5f * u * u;
+        }
+        break;
+    case easing::cubic_in:
+        for (float & t : values) { t = t * t * t; }
+        break;
+    case easing::cubic_out:
+        for (float & t : values) {
+            float const u = t - 1.0f;
+            t = u * u * u + 1.0f;
+        }
+        break;
+    case easing::cubic_in_out:
+        for (float & t : values) {
+            float const u = 2.0f - 2.0f * t;
+            t = t < 0.5f ? 4.0f * t * t * t : 1.0f - 0.5f * u * u * u;
+        }
+        break;
+    case easing::sine_in:
+        for (float & t : values) { t = 1.0f - std::cos(t * half_pi); }
+        break;
+    case easing::sine_out:
+        for (float & t : values) { t = std::sin(t * half_pi); }
+        break;
+    case easing::sine_in_out:
+        for (float & t : values) { t = 0.5f - 0.5f * std::cos(t * pi); }
+        break;
+    case easing::back_out:
+        for (float & t : values) {
+            float constexpr c1 = 1.70158f;
+            float constexpr c3 = c1 + 1.0f;
+            float const u = t - 1.0f;
+            t = 1.0f + c3 * u * u * u + c1 * u * u;
+        }
+        break;
+    case easing::count:
+        break;
+    }
+}
+
+/**
+ * \brief A cubic bezier easing curve from (0, 0) to (1, 1), baked into a
+ *        table of evenly spaced samples
+ */
+struct _easing_table {
+    std::array<float, limits::easing_table_size + 1> samples;
+
+    _easing_table(float x1, float y1, float x2, float y2)
+    {
+        auto const bezier = [](float a, float b, float t) {
+            float const u = 1.0f - t;
+            return 3.0f * u * u * t * a + 3.0f * u * t * t * b + t * t * t;
+        };
+        for (std::size_t i = 0; i <= limits::easing_table_size; ++i) {
+            // find the curve parameter at this x by bisection, since x is
+            // monotonic in it for control points with x in [0, 1]
+            float const x = static_cast<float>(i) / limits::easing_table_size;
+            float low = 0.0f, high = 1.0f;
+            for (int step = 0; step < 24; ++step) {
+                float const middle = 0.5f * (low + high);
+                (bezier(x1, x2, middle) < x ? low : high) = middle;
+            }
+            samples[i] = bezier(y1, y2, 0.5f * (low + high));
+        }
+    }
+
+    void ease(std::span<float> values) const
+    {
+        float constexpr last = limits::easing_table_size - 1;
+        for (float & t : values) {
+            float const position = t * limits::easing_table_size;
+            float const index = std::min(std::floor(position), last);
+            float const fraction = position - index;
+            std::size_t const i = static_cast<std::size_t>(index);
+            t = samples[i] + (samples[i + 1] - samples[i]) * fraction;
+        }
+    }
+};
+
+/**
+ * \brief A tween preset: where it goes from and to, how long it takes, and
+ *        how it eases
+ */
+struct tween_template {
+    float from = 0.0f;
+    float to = 1.0f;
+    float duration = 1.0f;
+    easing_id easing = 0;
+};
+
+/**
+ * \brief Every running tween, grouped by easing function
+ *
+ * Each easing function has a group of tweens in parallel arrays, and each
+ * group updates in a few branch-free loops. Tweens that finish are reported
+ * together by each update:
+ *
+ *      raisin::tweens tweens;
+ *      auto loaded = raisin::parse_file("ui.toml")
+ *          .and_then(raisin::load_tweens("tweens", tweens));
+ *
+ *      auto const fade = tweens.start(*tweens.find_template("fade-in"),
+ *                                     &panel.alpha);
+ *
+ *      for (raisin::tween_id done : tweens.update(frame_seconds)) {
+ *          on_tween_finished(done);
+ *      }
+ */
+class tweens {
+public:
+    tweens()
+        : groups(static_cast<std::size_t>(easing::count))
+    {
+        for (std::size_t i = 0; i < _easing_names.size(); ++i) {
+            easing_ids.emplace(_easing_names[i], static_cast<easing_id>(i));
+        }
+    }
+
+    /**
+     * \brief Find an easing function by name, built in or a preset
+     */
+    std::optional<easing_id> find_easing(std::string_view name) const
+    {
+        auto const found = easing_ids.find(name);
+        if (found == easing_ids.end()) { return std::nullopt; }
+        return found->second;
+    }
+
+    /**
+     * \brief Name an easing function, such as to alias a built-in easing
+     */
+    void add_easing(std::string const & name, easing_id id)
+    {
+        easing_ids.insert_or_assign(name, id);
+    }
+
+    /**
+     * \brief Add a cubic bezier easing, like CSS's cubic-bezier()
+     *
+     * \return the id of the easing
+     */
+    easing_id add_easing(std::string const & name,
+                         float x1, float y1, float x2, float y2)
+    {
+        auto const id = static_cast<easing_id>(groups.size());
+        groups.emplace_back();
+        groups.back().table.emplace(std::clamp(x1, 0.0f, 1.0f), y1,
+                                    std::clamp(x2, 0.0f, 1.0f), y2);
+        add_easing(name, id);
+        return id;
+    }
+
+    /**
+     * \brief Find a tween template by name
+     */
+    std::optional<std::uint32_t> find_template(std::string_view name) const
+    {
+        auto const found = template_ids.find(name);
+        if (found == template_ids.end()) { return std::nullopt; }
+        return found->second;
+    }
+
+    /**
+     * \brief Add a tween template
+     *
+     * \return the id of the template
+     */
+    std::uint32_t add_template(std::string const & name,
+                               tween_template const & preset)
+    {
+        auto const id = static_cast<std::uint32_t>(templates.size());
+        templates.push_back(preset);
+        template_ids.insert_or_assign(name, id);
+        return id;
+    }
+
+    /**
+     * \brief Start a tween
+     *
+     * \param from      the value to start at
+     * \param to        the value to end at
+     * \param duration  how long the tween takes, in seconds, finishing on
+     *                  the next update if it's zero or less
+     * \param easing    the easing function
+     * \param target    where to write the value on every update, or null
+     *
+     * \return the id of the tween
+     */
+    tween_id start(float from, float to, float duration, easing_id easing,
+                   float * target = nullptr)
+    {
+        tween_id id;
+        if (free_ids.empty()) {
+            id = static_cast<tween_id>(locations.size());
+            locations.emplace_back();
+        }
+        else {
+            id = free_ids.back();
+            free_ids.pop_back();
+        }
+
+        // an instant tween starts at full progress rather than with an
+        // infinite rate, which would make 0 * inf = NaN on its first update
+        bool const instant = not (duration > 0.0f);
+        float const value = instant ? to : from;
+
+        group & added = groups[easing];
+        locations[id] = { easing, static_cast<std::uint32_t>(added.ids.size()) };
+        added.ids.push_back(id);
+        added.starts.push_back(from);
+        added.changes.push_back(to - from);
+        added.rates.push_back(instant ? 1.0f : 1.0f / duration);
+        added.elapsed.push_back(instant ? 1.0f : 0.0f);
+        added.values.push_back(value);
+        added.targets.push_back(target);
+        if (target) { *target = value; }
+        return id;
+    }
+
+    /**
+     * \brief Start a tween from a template
+     */
+    tween_id start(std::uint32_t template_id, float * target = nullptr)
+    {
+        tween_template const & preset = templates[template_id];
+        return start(preset.from, preset.to, preset.duration, preset.easing,
+                     target);
+    }
+
+    /**
+     * \brief Stop a running tween without finishing it
+     *
+     * \note Cancelling a tween that already finished or was cancelled does
+     *       nothing.
+     */
+    void cancel(tween_id id)
+    {
+        location & found = locations[id];
+        if (found.slot == finished_slot or found.slot == free_slot) { return; }
+        groups[found.group].remove(found.slot, locations);
+        found.slot = free_slot;
+        free_ids.push_back(id);
+    }
+
+    /**
+     * \brief The current value of a running tween, or the final value of a
+     *        finished one until its id is reused
+     *
+     * \note The id must not be of a cancelled tween.
+     */
+    float value(tween_id id) const
+    {
+        location const & found = locations[id];
+        assert(found.slot != free_slot and "the tween was cancelled");
+        if (found.slot == finished_slot) { return found.final_value; }
+        return groups[found.group].values[found.slot];
+    }
+
+    /**
+     * \brief The number of running tweens
+     */
+    std::size_t size() const
+    {
+        std::size_t count = 0;
+        for (group const & running : groups) { count += running.ids.size(); }
+        return count;
+    }
+
+    /**
+     * \brief Advance every tween
+     *
+     * \param seconds   the time since the last update
+     *
+     * \return the ids of the tweens that finished, which stay valid until
+     *         the next update
+     */
+    std::span<tween_id const> update(float seconds)
+    {
+        // the ids that finished last update can be reused now
+        for (tween_id id : finished) { free_ids.push_back(id); }
+        finished.clear();
+
+        for (std::size_t id = 0; id < groups.size(); ++id) {
+            group & running = groups[id];
+            std::size_t const count = running.ids.size();
+            if (count == 0) { continue; }
+
+            std::span<float> const progress{ running.values };
+            for (std::size_t i = 0; i < count; ++i) {
+                running.elapsed[i] += seconds;
+                progress[i] = std::min(running.elapsed[i] * running.rates[i],
+                                       1.0f);
+            }
+            if (running.table) {
+                running.table->ease(progress);
+            }
+            else {
+                _ease(static_cast<easing>(id), progress);
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                progress[i] = running.starts[i] + running.changes[i] * progress[i];
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                if (running.targets[i]) { *running.targets[i] = progress[i]; }
+            }
+
+            // remove finished tweens from the back, so slots don't shift
+            // under the loop
+            for (std::size_t i = count; i-- > 0; ) {
+                if (running.elapsed[i] * running.rates[i] < 1.0f) { continue; }
+                tween_id const done = running.ids[i];
+                float const final_value = running.values[i];
+                running.remove(i, locations);
+                locations[done] = { 0, finished_slot, final_value };
+                finished.push_back(done);
+            }
+        }
+        return finished;
+    }
+
+private:
+    // the slots of tweens that finished and were cancelled
+    static std::uint32_t constexpr finished_slot = UINT32_MAX;
+    static std::uint32_t constexpr free_slot = UINT32_MAX - 1;
+
+    struct location {
+        std::uint32_t group = 0;
+        std::uint32_t slot = 0;
+
+        // the value a tween finished at
+        float final_value = 0.0f;
+    };
+
+    struct group {
+        std::vector<tween_id> ids;
+        std::vector<float> starts;
+        std::vector<float> changes;
+        std::vector<float> rates;
+        std::vector<float> elapsed;
+        std::vector<float> values;
+        std::vector<float *> targets;
+
+        // the baked curve of a bezier easing, or nothing for built-ins
+        std::optional<_easing_table> table;
+
+        void remove(std::size_t slot, std::vector<location> & locations)
+        {
+            auto const swap_remove = [slot](auto & values) {
+                values[slot] = values.back();
+                values.pop_back();
+            };
+            locations[ids.back()].slot = static_cast<std::uint32_t>(slot);
+            swap_remove(ids);
+            swap_remove(starts);
+            swap_remove(changes);
+            swap_remove(rates);
+            swap_remove(elapsed);
+            swap_remove(values);
+            swap_remove(targets);
+        }
+    };
+
+    std::vector<group> groups;
+    std::vector<location> locations;
+    std::vector<tween_id> free_ids;
+    std::vector<tween_id> finished;
+
+    std::vector<tween_template> templates;
+    std::map<std::string, easing_id, std::less<>> easing_ids;
+    std::map<std::string, std::uint32_t, std::less<>> template_ids;
+};
+
+inline std::optional<std::string>
+_load_easings(toml::table const & easings, std::string const & variable_path,
+              tweens & output)
+{
+    for (auto && [key, node] : easings) {
+        std::string const path = variable_path + "."s + key.str();
+        if (auto const name = node.value<std::string>()) {
+            auto const id = output.find_easing(*name);
+            if (not id) { return "No easing named "s + *name + " for "s + path; }
+            output.add_easing(key.str(), *id);
+            continue;
+        }
+
+        float points[4];
+        auto const loaded = load_array(easings, key.str(), points);
+        if (not loaded or *loaded != std::end(points)) {
+            return path + " must be the name of an easing, or the control "s
+                   "points of a cubic bezier, [x1, y1, x2, y2]"s;
+        }
+        output.add_easing(key.str(), points[0], points[1], points[2], points[3]);
+    }
+    return std::nullopt;
+}
+
+inline std::optional<std::string>
+_load_templates(toml::table const & templates,
+                std::string const & variable_path, tweens & output)
+{
+    for (auto && [key, node] : templates) {
+        std::string const path = variable_path + "."s + key.str();
+        auto const * table = node.as_table();
+        if (not table) { return path + " must be a table"s; }
+
+        tween_template preset;
+        preset.from = (*table)["from"].value_or(preset.from);
+        preset.to = (*table)["to"].value_or(preset.to);
+        preset.duration = (*table)["duration"].value_or(preset.duration);
+        auto const easing_name = (*table)["easing"].value_or("linear"s);
+        auto const id = output.find_easing(easing_name);
+        if (not id) {
+            return "No easing named "s + easing_name + " for "s + path;
+        }
+        preset.easing = *id;
+        output.add_template(key.str(), preset);
+    }
+    return std::nullopt;
+}
+
+/**
+ * \brief Load easing presets and tween templates
+ *
+ * Easings are named built-in easings or cubic bezier control points, and
+ * templates refer to easings by name:
+ *
+ *      [tweens.easings]
+ *      pop = "back-out"
+ *      snappy = [0.2, 0.9, 0.1, 1.0]
+ *
+ *      [tweens.templates.fade-in]
+ *      from = 0.0
+ *      to = 1.0
+ *      duration = 0.25
+ *      easing = "snappy"
+ *
+ * \param variable_path     the toml path to the table of easings and
+ *                          templates
+ * \param output            the tweens to add the easings and templates to
+ *
+ * \return a function that loads the easings and templates from a table, and
+ *         returns the table or a descriptive error message
+ */
+inline auto load_tweens(std::string const & variable_path, tweens & output)
+{
+    return [&variable_path, &output](toml::table const & table)
+        -> expected<toml::table, std::string>
+    {
+        auto const definitions = subtable_view(table, variable_path);
+        if (not definitions) { return unexpected(definitions.error()); }
+
+        if (auto const * easings = (**definitions)["easings"].as_table()) {
+            auto error = _load_easings(*easings, variable_path + ".easings"s,
+                                       output);
+            if (error) { return unexpected{ *error }; }
+        }
+        if (auto const * templates = (**definitions)["templates"].as_table()) {
+            auto error = _load_templates(*templates,
+                                         variable_path + ".templates"s, output);
+            if (error) { return unexpected{ *error }; }
+        }
+        return table;
+    };
+}
+}
@@ -0,0 +1,384 @@
+#pragma once
+#include "raisin/future.hpp"
+#include "raisin/fundamental_types.hpp"
+
+// data types
+#include <string>
+#include <cstddef>
+#include <cmath>
+
+// data structures
+#include <span>
+#include <vector>
+#include <array>
+#include <algorithm>
+
+// serialization
+#define TOML_EXCEPTIONS 0
+#include <toml++/toml.h>
+
+inline namespace raisin {
+
+using namespace std::string_literals;
+
+/**
+ * \brief A 2d vector of floats, aligned so pairs load as one 64-bit word
+ */
+struct alignas(8) vec2f {
+    float x = 0.0f;
+    float y = 0.0f;
+
+    friend bool operator==(vec2f const &, vec2f const &) = default;
+    friend vec2f operator+(vec2f a, vec2f b) { return { a.x + b.x, a.y + b.y }; }
+    friend vec2f operator-(vec2f a, vec2f b) { return { a.x - b.x, a.y - b.y }; }
+    friend vec2f operator*(vec2f a, float s) { return { a.x * s, a.y * s }; }
+};
+
+/**
+ * \brief A 4d vector of floats, aligned to fill one 128-bit register
+ */
+struct alignas(16) vec4f {
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float w = 0.0f;
+
+    friend bool operator==(vec4f const &, vec4f const &) = default;
+    friend vec4f operator+(vec4f a, vec4f b)
+    {
+        return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+    }
+    friend vec4f operator-(vec4f a, vec4f b)
+    {
+        return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+    }
+    friend vec4f operator*(vec4f a, float s)
+    {
+        return { a.x * s, a.y * s, a.z * s, a.w * s };
+    }
+};
+
+template<typename vec_t>
+inline constexpr std::size_t _vec_size = 0;
+template<> inline constexpr std::size_t _vec_size<vec2f> = 2;
+template<> inline constexpr std::size_t _vec_size<vec4f> = 4;
+
+template<typename vec_t>
+concept float_vector = _vec_size<vec_t> > 0;
+
+inline constexpr std::array<char const *, 4> _vec_components{
+    "x", "y", "z", "w" };
+
+/**
+ * \brief A component of a vector by index
+ *
+ * \note The members are named rather than indexed through a pointer to x,
+ *       which would index past a single object.
+ */
+template<float_vector vec_t>
+float & _component(vec_t & vector, std::size_t i)
+{
+    if constexpr (_vec_size<vec_t> == 4) {
+        switch (i) {
+        case 0: return vector.x;
+        case 1: return vector.y;
+        case 2: return vector.z;
+        default: return vector.w;
+        }
+    }
+    else {
+        return i == 0 ? vector.x : vector.y;
+    }
+}
+
+/**
+ * \brief Read a vector from a node without building any paths
+ *
+ * A vector is written as an array of numbers, [x, y], or as an inline table,
+ * { x = 1, y = 2 }.
+ *
+ * \return whether the node is a vector of the right size
+ */
+template<float_vector vec_t>
+bool _read_vector(toml::node const & node, vec_t & output)
+{
+    if (auto const * array = node.as_array()) {
+        if (array->size() != _vec_size<vec_t>) { return false; }
+        for (std::size_t i = 0; i < _vec_size<vec_t>; ++i) {
+            auto const value = (*array)[i].value<float>();
+            if (not value) { return false; }
+            _component(output, i) = *value;
+        }
+        return true;
+    }
+    if (auto const * table = node.as_table()) {
+        if (table->size() != _vec_size<vec_t>) { return false; }
+        for (std::size_t i = 0; i < _vec_size<vec_t>; ++i) {
+            toml::node const * component = table->get(_vec_components[i]);
+            auto const value = component ?
+                component->value<float>() : std::nullopt;
+            if (not value) { return false; }
+            _component(output, i) = *value;
+        }
+        return true;
+    }
+    return false;
+}
+
+template<float_vector vec_t>
+std::string _vector_form()
+{
+    std::string array_form = "[";
+    std::string table_form = "{ ";
+    for (std::size_t i = 0; i < _vec_size<vec_t>; ++i) {
+        std::string const separator = i == 0 ? ""s : ", "s;
+        array_form += separator + _vec_components[i];
+        table_form += separator + _vec_components[i] + " = "s +
+                      _vec_components[i];
+    }
+    return array_form + "] or "s + table_form + " }"s;
+}
+
+template<float_vector vec_t>
+expected<vec_t, std::string>
+_load_vector(toml::table const & table, std::string const & variable_path)
+{
+    toml::node const * node = table.at_path(variable_path).node();
+    if (not node) {
+        return unexpected{ _missing_variable(variable_path) };
+    }
+    vec_t vector;
+    if (not _read_vector(*node, vector)) {
+        std::string const description =
+            "Expecting "s + variable_path + " to be a vector like "s +
+            _vector_form<vec_t>() + ", but it isn't"s;
+        return unexpected{ description };
+    }
+    return vector;
+}
+
+template<>
+inline expected<vec2f, std::string>
+load_value<vec2f>(toml::table const & table, std::string const & variable_path)
+{
+    return _load_vector<vec2f>(table, variable_path);
+}
+
+template<>
+inline expected<vec4f, std::string>
+load_value<vec4f>(toml::table const & table, std::string const & variable_path)
+{
+    return _load_vector<vec4f>(table, variable_path);
+}
+
+/**
+ * \brief Load an array of vectors into contiguous storage
+ *
+ * Paths, polygons and control points are arrays of vectors like
+ * [[x, y], [x, y], ...], which are read straight into one allocation:
+ *
+ *      auto path = raisin::load_vectors<raisin::vec2f>(table, "patrol.points");
+ *
+ * \param table             the table with the array to load
+ * \param variable_path     the toml path to the array
+ *
+ * \return the vectors, or a descriptive error message naming the first
+ *         element that isn't a vector
+ */
+template<float_vector vec_t>
+expected<std::vector<vec_t>, std::string>
+load_vectors(toml::table const & table, std::string const & variable_path)
+{
+    auto const * array = table.at_path(variable_path).as_array();
+    if (not array) {
+        if (not table.at_path(variable_path)) {
+            return unexpected{ _missing_variable(variable_path) };
+        }
+        return unexpected{ variable_path + " must be an array"s };
+    }
+
+    std::vector<vec_t> vectors(array->size());
+    for (std::size_t i = 0; i < vectors.size(); ++i) {
+        if (not _read_vector((*array)[i], vectors[i])) {
+            std::string const description =
+                "Expecting "s + variable_path + "["s + std::to_string(i) +
+                "] to be a vector like "s + _vector_form<vec_t>() +
+                ", but it isn't"s;
+            return unexpected{ description };
+        }
+    }
+    return vectors;
+}
+
+/**
+ * \brief Load an array of vectors into an output
+ *
+ * \param variable_path     the toml path to the array
+ * \param output            where to store the vectors
+ *
+ * \return a function that loads the vectors from a table, and returns the
+ *         table or a descriptive error message
+ */
+template<float_vector vec_t>
+auto load_vectors(std::string const & variable_path,
+                  std::vector<vec_t> & output)
+{
+    return [&variable_path, &output](toml::table const & table)
+        -> expected<toml::table, std::string>
+    {
+        auto result = load_vectors<vec_t>(table, variable_path);
+        if (not result) { return unexpected(result.error()); }
+        output = std::move(*result);
+        return table;
+    };
+}
+
+/**
+ * \brief A 2d affine transform: a linear part, then a translation
+ *
+ *      x' = xx * x + xy * y + tx
+ *      y' = yx * x + yy * y + ty
+ */
+struct affine2f {
+    float xx = 1.0f, xy = 0.0f, tx = 0.0f;
+    float yx = 0.0f, yy = 1.0f, ty = 0.0f;
+};
+
+/**
+ * \brief Make a transform that scales, then rotates, then translates
+ *
+ * \param position  the translation
+ * \param rotation  the counter-clockwise rotation, in degrees
+ * \param scale     the scale along each axis
+ */
+inline affine2f make_affine(vec2f position, float rotation, vec2f scale)
+{
+    float const radians = rotation * 0.017453292519943295f;
+    float const cos = std::cos(radians);
+    float const sin = std::sin(radians);
+    return { cos * scale.x, -sin * scale.y, position.x,
+             sin * scale.x, cos * scale.y, position.y };
+}
+
+/**
+ * \brief Combine two transforms into one that applies the inner transform,
+ *        then the outer transform
+ */
+inline affine2f compose(affine2f const & outer, affine2f const & inner)
+{
+    return { outer.xx * inner.xx + outer.xy * inner.yx,
+             outer.xx * inner.xy + outer.xy * inner.yy,
+             outer.xx * inner.tx + outer.xy * inner.ty + outer.tx,
+             outer.yx * inner.xx + outer.yy * inner.yx,
+             outer.yx * inner.xy + outer.yy * inner.yy,
+             outer.yx * inner.tx + outer.yy * inner.ty + outer.ty };
+}
+
+/**
+ * \brief An axis-aligned box
+ */
+struct box2f {
+    vec2f min;
+    vec2f max;
+};
+
+/*
+ * The batch operations below are plain loops over contiguous floats with no
+ * branches or aliasing, which compilers vectorize at -O2 and above.
+ */
+
+/**
+ * \brief Transform each point
+ *
+ * \param points    the points to transform
+ * \param transform the transform to apply
+ * \param output    where to write the transformed points, which may be the
+ *                  same as the points, and must be at least as large
+ */
+inline void transform(std::span<vec2f const> points, affine2f const & transform,
+                      std::span<vec2f> output)
+{
+    std::size_t const count = std::min(points.size(), output.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        vec2f const point = points[i];
+        output[i] = { transform.xx * point.x + transform.xy * point.y + transform.tx,
+                      transform.yx * point.x + transform.yy * point.y + transform.ty };
+    }
+}
+
+/**
+ * \brief Transform each vector by a row-major 4x4 matrix
+ *
+ * \param vectors   the vectors to transform
+ * \param matrix    the matrix to multiply by, in row-major order
+ * \param output    where to write the transformed vectors, which may be the
+ *                  same as the vectors, and must be at least as large
+ */
+inline void transform(std::span<vec4f const> vectors,
+                      std::array<float, 16> const & matrix,
+                      std::span<vec4f> output)
+{
+    std::size_t const count = std::min(vectors.size(), output.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        vec4f const v = vectors[i];
+        auto const row = [&matrix, &v](std::size_t r) {
+            return matrix[4 * r] * v.x + matrix[4 * r + 1] * v.y +
+                   matrix[4 * r + 2] * v.z + matrix[4 * r + 3] * v.w;
+        };
+        output[i] = { row(0), row(1), row(2), row(3) };
+    }
+}
+
+/**
+ * \brief The smallest box that holds every point
+ *
+ * \return the bounds, or an inverted box with min above max if there are no
+ *         points
+ */
+inline box2f bounds(std::span<vec2f const> points)
+{
+    float constexpr huge = HUGE_VALF;
+    float min_x = huge, min_y = huge, max_x = -huge, max_y = -huge;
+    for (vec2f const & point : points) {
+        min_x = std::min(min_x, point.x);
+        min_y = std::min(min_y, point.y);
+        max_x = std::max(max_x, point.x);
+        max_y = std::max(max_y, point.y);
+    }
+    return { { min_x, min_y }, { max_x, max_y } };
+}
+
+/**
+ * \brief The distance from a point to each of some points
+ *
+ * \param points    the points to measure to
+ * \param from      the point to measure from
+ * \param output    where to write the distances, which must be at least as
+ *                  large as the points
+ */
+inline void distances(std::span<vec2f const> points, vec2f from,
+                      std::span<float> output)
+{
+    std::size_t const count = std::min(points.size(), output.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        float const dx = points[i].x - from.x;
+        float const dy = points[i].y - from.y;
+        output[i] = std::sqrt(dx * dx + dy * dy);
+    }
+}
+
+/**
+ * \brief The squared distance from a point to each of some points, which is
+ *        cheaper than the distance for comparisons
+ */
+inline void squared_distances(std::span<vec2f const> points, vec2f from,
+                              std::span<float> output)
+{
+    std::size_t const count = std::min(points.size(), output.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        float const dx = points[i].x - from.x;
+        float const dy = points[i].y - from.y;
+        output[i] = dx * dx + dy * dy;
+    }
+}
+}